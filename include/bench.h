@@ -0,0 +1,13 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+namespace Bench {
+
+// Searches a fixed set of positions to a fixed depth from a cleared state
+// and prints total nodes, time and nodes/sec. With one thread the node
+// total is deterministic and serves as a signature of search behaviour.
+void run(int hash_mb, int threads, int depth);
+
+} // namespace Bench
+
+#endif // BENCH_H
@@ -29,6 +29,10 @@ inline int count(Bitboard bb) {
     return __builtin_popcountll(bb);
 }
 
+inline bool more_than_one(Bitboard bb) {
+    return bb & (bb - 1);
+}
+
 inline bool is_light_square(Square s) {
     return ((s / 8) + (s % 8)) % 2 != 0;
 }
@@ -43,6 +47,15 @@ Bitboard rook_attacks(Square s, Bitboard occupied);
 Bitboard queen_attacks(Square s, Bitboard occupied);
 Bitboard pawn_attacks(Square s, Color c);
 
+// Squares strictly between two squares on a common rank, file or diagonal
+// (empty if they are not aligned), and the full line through them.
+Bitboard between(Square a, Square b);
+Bitboard line(Square a, Square b);
+
+inline bool aligned(Square a, Square b, Square c) {
+    return line(a, b) & square_bb(c);
+}
+
 extern Bitboard FileABB;
 extern Bitboard Rank1BB;
 
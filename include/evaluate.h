@@ -9,9 +9,28 @@ namespace Eval {
 // Initialize static tables (PSQT, masks, etc.)
 void init();
 
+// Per-piece terms kept incrementally in StateInfo by Position::put_piece/
+// remove_piece. White's point of view: black entries are negated.
+extern Score PieceMaterial[PIECE_NB];
+extern Score PieceSquare[PIECE_NB][SQ_NB];
+extern const int PhaseWeight[PIECE_TYPE_NB];
+
 // Main evaluation function
 int evaluate(const Position& pos);
 
+// Pawn/material cache counters. Each thread counts privately; a search
+// worker publishes its counts with publish_cache_stats() when its job
+// ends, so cache_stats() covers every search run so far plus the calling
+// thread's own unpublished counts.
+struct CacheStats {
+    uint64_t pawn_probes = 0;
+    uint64_t pawn_hits = 0;
+    uint64_t material_probes = 0;
+    uint64_t material_hits = 0;
+};
+CacheStats cache_stats();
+void publish_cache_stats();
+
 // Debug/Tracing
 std::string trace(const Position& pos);
 
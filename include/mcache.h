@@ -48,6 +48,8 @@ public:
         static_assert((Size & (Size - 1)) == 0, "CacheTable Size must be power of 2");
         size_t bytes = Size * sizeof(EntryType);
         table_ = static_cast<EntryType*>(aligned_alloc(bytes, 64)); // Cache-line aligned
+        // Zeroed so a thread_local table never serves a stale key from garbage
+        clear();
     }
 
     ~CacheTable() {
@@ -27,7 +27,18 @@ namespace Misc {
         }
     };
 
-    // Logging (thread-safe ideally, but simple for now)
+    // --- Output ---
+    // Protocol output from any thread goes through one queue: producers
+    // never block on stdout, and a writer thread flushes whatever has
+    // piled up in one write, keeping lines whole and in order.
+
+    // Queues one line (without the newline) for stdout
+    void out(std::string line);
+
+    // Blocks until every line queued so far has been written
+    void flush_out();
+
+    // "info string <msg>" through the output queue
     void log(const std::string& msg);
 }
 
@@ -8,7 +8,12 @@
 namespace MoveGen {
 
 enum GenType {
-    ALL, CAPTURES, QUIETS
+    ALL,       // Pseudo-legal
+    CAPTURES,  // Pseudo-legal captures, capture-promotions and en passant
+    QUIETS,    // Pseudo-legal non-captures, including push-promotions
+    EVASIONS,  // In check: king steps plus captures/blocks of a single checker
+    QUIET_CHECKS, // Not in check: non-captures that give check (direct or discovered)
+    LEGAL      // Fully legal, using pins and check info from StateInfo
 };
 
 struct MoveList {
@@ -7,6 +7,7 @@
 #include <atomic>
 #include <vector>
 #include <functional>
+#include <memory>
 
 namespace Opt {
 
@@ -29,30 +30,49 @@ public:
     }
 };
 
+// Worker that lives for the lifetime of the pool. Between jobs it parks
+// on a condition variable, so starting a search costs a notify, not a
+// thread creation.
 class Thread {
 public:
     std::thread std_thread;
     int id;
     std::atomic<bool> searching;
-    
-    Thread(int id) : id(id), searching(false) {}
-    virtual ~Thread() { if(std_thread.joinable()) std_thread.join(); }
-    
+
+    explicit Thread(int id);
+    ~Thread();
+
+    // Hand a job to the parked worker; returns immediately
+    void run(std::function<void(int)> job);
+    // Block until the current job (if any) has returned
+    void wait();
+
     // Bind thread to specific core
     void bind();
+
+private:
+    void idle_loop();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::function<void(int)> job;
+    bool exit = false;
 };
 
 class ThreadPool {
     std::vector<std::unique_ptr<Thread>> threads;
-    std::atomic<bool> stop_flag;
     
 public:
     ThreadPool();
     ~ThreadPool();
     
+    // Resizes the pool; existing workers are kept if the size is unchanged
     void init(int num_threads);
     void start_search(std::function<void(int)> search_func);
     void wait_for_completion();
+    // Waits for every worker except 0; called from worker 0's own job
+    void wait_for_helpers();
+    // Waits for running jobs and shuts the workers down
     void stop();
     
     int size() const { return threads.size(); }
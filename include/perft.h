@@ -0,0 +1,27 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include "position.h"
+#include <cstdint>
+
+namespace Perft {
+
+// Leaf count of the legal move tree. Leaves are bulk-counted from the
+// size of the legal move list at depth 1. With use_hash, subtree counts
+// are cached in a shared lockless table keyed by position and depth.
+uint64_t perft(Position& pos, int depth, bool use_hash = false);
+
+// "go perft N": root moves split across worker threads, prints the
+// total with time and nodes/sec.
+void go(const Position& pos, int depth, bool use_hash = false);
+
+// "divide N": per-root-move counts, then the total.
+void divide(const Position& pos, int depth, bool use_hash = false);
+
+// Standard positions (Kiwipete etc.) with known counts; prints pass/fail
+// and nodes/sec for each, returns false on any mismatch.
+bool suite();
+
+} // namespace Perft
+
+#endif // PERFT_H
@@ -12,9 +12,18 @@ struct StateInfo {
     Square ep_square;
     int halfmove_clock;
     uint64_t key;
+    uint64_t pawn_key;     // Pawns only, for the pawn structure cache
+    uint64_t material_key; // Piece counts only, for the material cache
     Piece captured_piece;
-    int material_score;
-    int pst_score;
+    Score material_score; // White's point of view, maintained by put/remove_piece
+    Score pst_score;
+    int phase;            // 0 (bare kings) .. 24 (all pieces), may exceed with promotions
+
+    // Check info, recomputed once per make_move by set_check_info()
+    Bitboard checkers;            // Enemy pieces giving check to the side to move
+    Bitboard blockers[COLOR_NB];  // Pieces (either colour) shielding that colour's king from a slider
+    Bitboard pinners[COLOR_NB];   // Sliders of that colour pinning a piece to the enemy king
+    Bitboard check_squares[PIECE_TYPE_NB]; // Where a piece of the side to move would check the enemy king
     StateInfo* previous;
 };
 
@@ -22,6 +31,10 @@ class Position {
 public:
     Position();
     void set_fen(const std::string& fen);
+
+    // Copy of 'other' whose current StateInfo is 'root' rather than one
+    // owned by the original, so each search thread has its own stack.
+    void copy_from(const Position& other, StateInfo& root);
     
     Bitboard pieces(Color c) const { return color_bb[c]; }
     Bitboard pieces(PieceType pt) const { return type_bb[pt]; }
@@ -32,6 +45,11 @@ public:
     Color side_to_move() const { return side; }
     
     uint64_t hash() const { return state->key; }
+    uint64_t pawn_key() const { return state->pawn_key; }
+    uint64_t material_key() const { return state->material_key; }
+    Score material_score() const { return state->material_score; }
+    Score pst_score() const { return state->pst_score; }
+    int game_phase() const { return state->phase; }
     const StateInfo* state_ptr() const { return state; }
     
     void make_move(Move m, StateInfo& next_state);
@@ -41,13 +59,31 @@ public:
     void unmake_null_move();
 
     bool is_attacked(Square s, Color attacker) const;
+    Bitboard attackers_to(Square s, Bitboard occupied) const;
+    Bitboard checkers() const { return state->checkers; }
+    Bitboard blockers_for_king(Color c) const { return state->blockers[c]; }
+    Bitboard pinned(Color c) const { return state->blockers[c] & pieces(c); }
+    // Our pieces shielding the enemy king from one of our sliders
+    Bitboard discovered_check_candidates() const { return state->blockers[side ^ 1] & pieces(side); }
+    Bitboard check_squares(PieceType pt) const { return state->check_squares[pt]; }
+    Square king_square(Color c) const { return Bitboards::lsb(pieces(c, KING)); }
+    bool is_capture(Move m) const { return board[m.to()] != NO_PIECE || m.type() == EN_PASSANT; }
     bool is_draw() const;
     bool is_repetition() const;
     bool is_insufficient_material() const;
     
     bool is_pseudo_legal(Move m) const;
+    // m must be pseudo-legal; checks only that our king is safe afterwards
     bool is_legal(Move m) const;
 
+    // Whether a pseudo-legal move checks the enemy king, directly or by
+    // uncovering a slider
+    bool gives_check(Move m) const;
+
+    // Static Exchange Evaluation: does the exchange sequence started by m
+    // on its destination square win at least 'threshold'?
+    bool see_ge(Move m, int threshold = 0) const;
+
     uint64_t hash_history[1024];
     int history_index;
 
@@ -55,6 +91,13 @@ private:
     void clear();
     void put_piece(Piece p, Square s);
     void remove_piece(Square s);
+    // Board and bitboards only, for unmake: the keys and scores come back
+    // with the previous StateInfo
+    void set_square(Piece p, Square s);
+    void clear_square(Square s);
+    void move_piece(Square from, Square to);
+    void set_check_info();
+    Bitboard slider_blockers(Bitboard sliders, Square s, Bitboard& pinners) const;
 
     Piece board[SQ_NB];
     Bitboard color_bb[COLOR_NB];
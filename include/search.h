@@ -21,23 +21,50 @@ struct Limits {
     std::vector<Move> searchmoves; // Restrict search to these moves
 };
 
+// Result of a completed iteration, handed to the time manager
 struct SearchInfo {
     int depth;
     int seldepth;
     long long nodes;
     int time_ms;
     int score;
+    Move best_move;
+    double best_move_effort; // Share of the main thread's nodes spent below best_move
 };
 
 // Global stop flag
 extern std::atomic<bool> stop_search;
 
-// Main entry point
+// Nodes of the last completed search, summed over all threads
+extern std::atomic<long long> nodes_searched;
+
+// Set before a "go ponder" search is started. While it is set the search
+// ignores its time limits and holds back bestmove.
+extern std::atomic<bool> pondering;
+
+// Builds search tables and registers for Tune parameter changes
+void init();
+
+// Starts a search on the thread pool and returns at once. The main
+// thread prints info lines and bestmove through Misc::out.
+void start(Position& pos, Limits limits);
+
+// Blocks until the running search (if any) has printed bestmove
+void wait();
+
+// Ends the running search, including a ponder or infinite one
+void stop();
+
+// start() followed by wait()
 void iterate(Position& pos, Limits limits);
 
 // Clear heuristics (History, Killers, etc.)
 void clear();
 
+// The expected move was played: the running search continues under
+// normal time management, or stops if its time is already used up
+void ponderhit();
+
 } // namespace Search
 
 #endif // SEARCH_H
\ No newline at end of file
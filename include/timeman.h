@@ -3,36 +3,46 @@
 
 #include "search.h"
 #include "types.h"
-#include <chrono>
+#include <cstdint>
 
 namespace ClercX {
 
+// Budget for one move. optimum_time() is scaled after every iteration by
+// how settled the search looks; maximum_time() is never exceeded.
 class TimeManager {
 public:
     void init(const Search::Limits& limits, Color us, int ply);
+
+    // Called by the main thread after each completed iteration: true once
+    // the scaled optimum is used up
     bool should_stop(const Search::SearchInfo& info);
+
     int64_t optimum_time() const;
     int64_t maximum_time() const;
 
+    // Milliseconds since init; under nodestime, nodes / nodestime
+    int64_t elapsed(int64_t nodes) const;
+
+    // False for depth, node and infinite searches
+    bool use_time() const { return timed; }
+
 private:
     int64_t startTime;
     int64_t optTime;
     int64_t maxTime;
-    
+    int64_t nodesPerMs;
+
     // Limits
-    bool infinite;
-    int64_t moveTime;
-    int movesToGo;
-    int64_t wTime, bTime;
-    int64_t wInc, bInc;
+    bool timed;
+    bool moveTime;
     int depthLimit;
     int64_t nodesLimit;
-    
-    // Logic
-    bool stability_detected;
-    double stability_factor;
 
-    int64_t elapsed() const;
+    // Search feedback from previous iterations
+    Move lastBestMove;
+    int lastScore;
+    int stableIterations;   // Iterations the best move has not changed
+    double bestMoveChanges; // Decays by half per iteration
 };
 
 extern TimeManager Time;
@@ -9,35 +9,88 @@ enum TTFlag {
     EXACT, ALPHA, BETA
 };
 
+// Depth is stored biased so that depth8 == 0 marks an empty slot and
+// (later) negative quiescence depths still fit in a byte.
+constexpr int DEPTH_OFFSET = -8;
+
+// Mate scores are searched as distance from the root but stored as
+// distance from the entry's own node, so an entry stays correct when it
+// is reached at another ply. Scores beyond MATE_BOUND - MAX_PLY are mates.
+inline int value_to_tt(int v, int ply) {
+    return v >= MATE_BOUND - MAX_PLY ? v + ply : v <= -(MATE_BOUND - MAX_PLY) ? v - ply : v;
+}
+
+inline int value_from_tt(int v, int ply) {
+    return v >= MATE_BOUND - MAX_PLY ? v - ply : v <= -(MATE_BOUND - MAX_PLY) ? v + ply : v;
+}
+
+// gen_bound packs the bound in the low 2 bits and the search generation
+// in the upper 6 bits.
+constexpr int GENERATION_BITS = 2;
+constexpr int GENERATION_DELTA = 1 << GENERATION_BITS;
+constexpr int GENERATION_CYCLE = 255 + GENERATION_DELTA;
+constexpr int GENERATION_MASK = (0xFF << GENERATION_BITS) & 0xFF;
+
+// 10 bytes. key16 is stored XOR'ed with a fold of the payload, so an entry
+// torn by two threads writing at once fails verification instead of handing
+// back a move/score pair that belongs to a different position.
 struct TTEntry {
-    uint64_t key;
+    uint16_t key16;
     Move move;
     int16_t score;
-    int8_t depth;
-    int8_t flag;
-    uint8_t age; 
-    uint8_t pad; // Pad to 16 bytes
+    int16_t eval;
+    uint8_t depth8;
+    uint8_t gen_bound;
+
+    int depth() const { return depth8 + DEPTH_OFFSET; }
+    TTFlag flag() const { return static_cast<TTFlag>(gen_bound & (GENERATION_DELTA - 1)); }
+    uint8_t generation() const { return gen_bound & GENERATION_MASK; }
+
+    uint16_t checksum() const {
+        return move.raw() ^ static_cast<uint16_t>(score) ^ static_cast<uint16_t>(eval)
+             ^ static_cast<uint16_t>(depth8 | (gen_bound << 8));
+    }
 };
 
+static_assert(sizeof(TTEntry) == 10, "TTEntry must stay 10 bytes");
+
+// Three entries per 32-byte cluster, two clusters per cache line.
+constexpr int CLUSTER_SIZE = 3;
+
+struct alignas(32) TTCluster {
+    TTEntry entry[CLUSTER_SIZE];
+    char pad[2];
+};
+
+static_assert(sizeof(TTCluster) == 32, "TTCluster must stay 32 bytes");
+
 class TranspositionTable {
 public:
     TranspositionTable(size_t size_mb);
     ~TranspositionTable();
-    
+
     void resize(size_t size_mb);
-    
-    void store(uint64_t key, Move m, int score, int depth, TTFlag flag, int ply);
+
+    void store(uint64_t key, Move m, int score, int eval, int depth, TTFlag flag, int ply);
     bool probe(uint64_t key, TTEntry& entry);
     void prefetch(uint64_t key);
     void clear();
-    void new_search(); 
+    void new_search();
+
+    // Permill of the table filled by the current search (UCI "hashfull")
+    int hashfull() const;
 
 private:
-    TTEntry* table;
-    size_t entry_count;
+    TTCluster* cluster(uint64_t key) const {
+        // Fast-range: maps the key onto [0, cluster_count) without a division
+        return &table[(static_cast<unsigned __int128>(key) * cluster_count) >> 64];
+    }
+
+    TTCluster* table;
+    size_t cluster_count;
     uint8_t generation;
 };
 
 extern TranspositionTable TT;
 
-#endif // TT_H
\ No newline at end of file
+#endif // TT_H
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include <functional>
 
 namespace Tune {
 
@@ -18,6 +19,10 @@ namespace Tune {
     void init();
     void set(const std::string& name, int value);
     int get(const std::string& name);
+
+    // Called with the parameter name after every successful set(), so
+    // tables derived from parameters can be rebuilt.
+    void on_change(std::function<void(const std::string&)> listener);
     
     // Output for SPSA
     void print_params();
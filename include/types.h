@@ -49,5 +49,28 @@ inline Color color_of(Piece p) {
 }
 
 const int MAX_PLY = 128;
+const int MATE_BOUND = 30000; // Mate in p plies from the root scores MATE_BOUND - p
+
+// Middlegame/endgame pair packed in one int: eg in the upper 16 bits,
+// mg in the lower 16. Adding and subtracting works on both halves at once.
+enum Score : int { SCORE_ZERO };
+
+constexpr Score make_score(int mg, int eg) {
+    return static_cast<Score>(static_cast<int>(static_cast<unsigned int>(eg) << 16) + mg);
+}
+
+inline int eg_value(Score s) {
+    return static_cast<int16_t>(static_cast<uint16_t>(static_cast<unsigned int>(s + 0x8000) >> 16));
+}
+
+inline int mg_value(Score s) {
+    return static_cast<int16_t>(static_cast<uint16_t>(static_cast<unsigned int>(s)));
+}
+
+constexpr Score operator+(Score a, Score b) { return static_cast<Score>(static_cast<int>(a) + static_cast<int>(b)); }
+constexpr Score operator-(Score a, Score b) { return static_cast<Score>(static_cast<int>(a) - static_cast<int>(b)); }
+constexpr Score operator-(Score a) { return static_cast<Score>(-static_cast<int>(a)); }
+inline Score& operator+=(Score& a, Score b) { return a = a + b; }
+inline Score& operator-=(Score& a, Score b) { return a = a - b; }
 
 #endif // TYPES_H
@@ -9,6 +9,7 @@ extern uint64_t piece_keys[PIECE_NB][SQ_NB];
 extern uint64_t side_key;
 extern uint64_t castle_keys[16];
 extern uint64_t en_passant_keys[SQ_NB];
+extern uint64_t material_keys[PIECE_NB][16]; // Indexed by piece count
 
 void init();
 
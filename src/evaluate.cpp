@@ -7,6 +7,8 @@
 #include <algorithm>
 #include <cmath>
 #include <sstream>
+#include <cassert>
+#include <mutex>
 
 namespace Eval {
 
@@ -23,13 +25,13 @@ struct Weights {
     int P_Passed[8][2];
     int P_Iso[2];
     int P_Double[2];
+    int Bishop_Pair[2];
     int Safety_Scale;
 } W;
 
 // Simple internal PSQT base (modified by Tune)
 // Simplified Bonus Tables (Center-centric)
 const int Bonus[PIECE_TYPE_NB][64] = {
-    {0}, // No Piece
     { // Pawn
       0,  0,  0,  0,  0,  0,  0,  0,
       5, 10, 10,-20,-20, 10, 10,  5,
@@ -92,7 +94,13 @@ const int Bonus[PIECE_TYPE_NB][64] = {
     }
 };
 
+Score PieceMaterial[PIECE_NB];
+Score PieceSquare[PIECE_NB][SQ_NB];
+const int PhaseWeight[PIECE_TYPE_NB] = { 0, 1, 1, 2, 4, 0 };
+
 // --- Pawn Hash Table ---
+// Tables are per thread: entries are several words wide and would tear if
+// Lazy SMP helpers shared them. Scores are from White's point of view.
 
 struct PawnEntry {
     uint64_t key;
@@ -100,7 +108,29 @@ struct PawnEntry {
     int eg;
     Bitboard passed[COLOR_NB];
 };
-MCache::CacheTable<PawnEntry, 16384> pawn_table;
+thread_local MCache::CacheTable<PawnEntry, 16384> pawn_table;
+
+// --- Material Hash Table ---
+
+struct MaterialEntry {
+    uint64_t key;
+    int mg;     // Imbalance terms (bishop pair), White's point of view
+    int eg;
+    int scale[COLOR_NB]; // Endgame scale when that side is ahead, out of 64
+};
+thread_local MCache::CacheTable<MaterialEntry, 8192> material_table;
+
+thread_local CacheStats stats;
+
+// Counts published by threads that have finished a search job
+std::mutex published_mutex;
+CacheStats published;
+
+Bitboard PassedMask[COLOR_NB][SQ_NB];
+Bitboard AdjacentFiles[8];
+
+// Passed pawn bonus per relative rank, as a multiple of Pawn_Passed / 2
+const int PassedScale[8] = { 0, 0, 1, 2, 4, 7, 11, 0 };
 
 // --- Term Helper ---
 
@@ -132,9 +162,15 @@ void refresh_weights() {
 
     W.P_Iso[0] = Tune::get("Pawn_Iso_MG"); W.P_Iso[1] = Tune::get("Pawn_Iso_EG");
     W.P_Double[0] = Tune::get("Pawn_Double_MG"); W.P_Double[1] = Tune::get("Pawn_Double_EG");
+    W.Bishop_Pair[0] = Tune::get("Bishop_Pair_MG"); W.Bishop_Pair[1] = Tune::get("Bishop_Pair_EG");
+
+    for(int r=0; r<8; ++r) {
+        W.P_Passed[r][0] = Tune::get("Pawn_Passed_MG") * PassedScale[r] / 2;
+        W.P_Passed[r][1] = Tune::get("Pawn_Passed_EG") * PassedScale[r] / 2;
+    }
     
     // Scale PSQT
-    for(int pt=1; pt<PIECE_TYPE_NB; ++pt) {
+    for(int pt=0; pt<PIECE_TYPE_NB; ++pt) {
         for(int s=0; s<64; ++s) {
             W.PSQT[pt][s][0] = Bonus[pt][s]; // Simple additive
             W.PSQT[pt][s][1] = Bonus[pt][s]; // Tuning usually refines this
@@ -142,12 +178,38 @@ void refresh_weights() {
     }
     
     W.Safety_Scale = Tune::get("Safety_Weight");
+
+    // Packed tables for incremental updates in Position
+    for(int pt=0; pt<PIECE_TYPE_NB; ++pt) {
+        Piece wp = make_piece(WHITE, static_cast<PieceType>(pt));
+        Piece bp = make_piece(BLACK, static_cast<PieceType>(pt));
+        PieceMaterial[wp] = make_score(W.Mat[pt][0], W.Mat[pt][1]);
+        PieceMaterial[bp] = -PieceMaterial[wp];
+        for(int s=0; s<64; ++s) {
+            PieceSquare[wp][s] = make_score(W.PSQT[pt][s][0], W.PSQT[pt][s][1]);
+            PieceSquare[bp][s ^ 56] = -PieceSquare[wp][s];
+        }
+    }
 }
 
 void init() {
     Tune::init();
     refresh_weights();
-    pawn_table.clear();
+
+    for(int f=0; f<8; ++f) {
+        AdjacentFiles[f] = 0;
+        if(f>0) AdjacentFiles[f] |= (Bitboards::FileABB << (f-1));
+        if(f<7) AdjacentFiles[f] |= (Bitboards::FileABB << (f+1));
+    }
+
+    // Squares on the same and adjacent files strictly in front of the pawn
+    for(int s=0; s<64; ++s) {
+        int f = s % 8, r = s / 8;
+        Bitboard span = AdjacentFiles[f] | (Bitboards::FileABB << f);
+        PassedMask[WHITE][s] = r < 7 ? span & (~0ULL << (8 * (r + 1))) : 0;
+        PassedMask[BLACK][s] = r > 0 ? span & (~0ULL >> (8 * (8 - r))) : 0;
+    }
+
     initialized = true;
 }
 
@@ -159,45 +221,138 @@ int safety_table[100] = {
 };
 
 template<Color Us>
-Term eval_pawns(const Position& pos) {
+Term eval_pawn_structure(const Position& pos, Bitboard& passed) {
+    constexpr Color Them = static_cast<Color>(Us ^ 1);
     Term score;
     Bitboard our_pawns = pos.pieces(Us, PAWN);
-    Bitboard their_pawns = pos.pieces(static_cast<Color>(Us^1), PAWN);
-    
-    // Check Cache
-    // Note: Hash only pawns for key usually, but here we just use full hash for simplicity or calc manual.
-    // For proper Pawn Hash, we need a key just for pawns. Position doesn't export it easily.
-    // We'll skip cache for this implementation to ensure correctness and avoiding heavy refactor of Position.
+    Bitboard their_pawns = pos.pieces(Them, PAWN);
 
+    passed = 0;
     Bitboard b = our_pawns;
     while(b) {
         Square s = Bitboards::pop_lsb(b);
         int f = s % 8;
-        
+
         // Isolation
-        Bitboard adj_files = 0;
-        if(f>0) adj_files |= (0x0101010101010101ULL << (f-1));
-        if(f<7) adj_files |= (0x0101010101010101ULL << (f+1));
-        
-        if(!(adj_files & our_pawns)) {
+        if(!(AdjacentFiles[f] & our_pawns)) {
             score.add(W.P_Iso[0], W.P_Iso[1]);
         }
-        
+
         // Doubled
-        Bitboard file_bb = (0x0101010101010101ULL << f);
+        Bitboard file_bb = (Bitboards::FileABB << f);
         if((file_bb & our_pawns) & ~(1ULL << s)) {
             // Only penalize one? Or both? Usually one penalty per extra pawn.
-             score.add(W.P_Double[0]/2, W.P_Double[1]/2); 
+             score.add(W.P_Double[0]/2, W.P_Double[1]/2);
+        }
+
+        // Passed: no enemy pawn in front on this or adjacent files
+        if(!(PassedMask[Us][s] & their_pawns)) {
+            passed |= Bitboards::square_bb(s);
+            int r = (Us == WHITE) ? s / 8 : 7 - s / 8;
+            score.add(W.P_Passed[r][0], W.P_Passed[r][1]);
         }
-        
-        // Passed (Simplified)
-        // No enemy pawns in front or adj files in front
-        // ...
     }
-    
+
     return score;
 }
 
+// Pawn structure only changes on pawn moves and captures of pawns, so the
+// result is cached per pawn configuration.
+const PawnEntry* probe_pawns(const Position& pos) {
+    uint64_t key = pos.pawn_key();
+    PawnEntry* e = pawn_table[key];
+    stats.pawn_probes++;
+
+    if (e->key == key) {
+        stats.pawn_hits++;
+        return e;
+    }
+
+    Term t = eval_pawn_structure<WHITE>(pos, e->passed[WHITE])
+           - eval_pawn_structure<BLACK>(pos, e->passed[BLACK]);
+    e->key = key;
+    e->mg = t.mg;
+    e->eg = t.eg;
+    return e;
+}
+
+const MaterialEntry* probe_material(const Position& pos) {
+    uint64_t key = pos.material_key();
+    MaterialEntry* e = material_table[key];
+    stats.material_probes++;
+
+    if (e->key == key) {
+        stats.material_hits++;
+        return e;
+    }
+
+    e->key = key;
+    e->mg = e->eg = 0;
+
+    int npm[COLOR_NB] = {0, 0};
+    for(int c=0; c<COLOR_NB; ++c) {
+        Color col = static_cast<Color>(c);
+        int sign = (col == WHITE) ? 1 : -1;
+        int knights = Bitboards::count(pos.pieces(col, KNIGHT));
+        int bishops = Bitboards::count(pos.pieces(col, BISHOP));
+        int rooks = Bitboards::count(pos.pieces(col, ROOK));
+        int queens = Bitboards::count(pos.pieces(col, QUEEN));
+
+        npm[c] = knights * W.Mat[KNIGHT][1] + bishops * W.Mat[BISHOP][1]
+               + rooks * W.Mat[ROOK][1] + queens * W.Mat[QUEEN][1];
+
+        if (bishops >= 2) {
+            e->mg += sign * W.Bishop_Pair[0];
+            e->eg += sign * W.Bishop_Pair[1];
+        }
+    }
+
+    // Without pawns, an edge of a minor piece or less rarely wins
+    for(int c=0; c<COLOR_NB; ++c) {
+        Color col = static_cast<Color>(c);
+        e->scale[c] = 64;
+        if (!pos.pieces(col, PAWN) && npm[c] - npm[c^1] <= W.Mat[BISHOP][1])
+            e->scale[c] = npm[c] < W.Mat[ROOK][1] ? 0 : 16;
+    }
+
+    return e;
+}
+
+CacheStats cache_stats() {
+    std::lock_guard<std::mutex> lk(published_mutex);
+    CacheStats total = published;
+    total.pawn_probes += stats.pawn_probes;
+    total.pawn_hits += stats.pawn_hits;
+    total.material_probes += stats.material_probes;
+    total.material_hits += stats.material_hits;
+    return total;
+}
+
+void publish_cache_stats() {
+    std::lock_guard<std::mutex> lk(published_mutex);
+    published.pawn_probes += stats.pawn_probes;
+    published.pawn_hits += stats.pawn_hits;
+    published.material_probes += stats.material_probes;
+    published.material_hits += stats.material_hits;
+    stats = CacheStats();
+}
+
+#ifndef NDEBUG
+// From-scratch recompute of the terms Position maintains incrementally
+bool incremental_ok(const Position& pos) {
+    Score mat = SCORE_ZERO, psq = SCORE_ZERO;
+    int phase = 0;
+    for(int s=0; s<64; ++s) {
+        Piece p = pos.piece_on(static_cast<Square>(s));
+        if (p == NO_PIECE) continue;
+        mat += PieceMaterial[p];
+        psq += PieceSquare[p][s];
+        phase += PhaseWeight[type_of(p)];
+    }
+    return mat == pos.material_score() && psq == pos.pst_score() && phase == pos.game_phase();
+}
+#endif
+
 // --- Main Eval ---
 
 int evaluate(const Position& pos) {
@@ -212,58 +367,47 @@ int evaluate(const Position& pos) {
     Bitboard them_pieces = pos.pieces(them);
     Bitboard all = us_pieces | them_pieces;
 
-    int phase = 0; // Total Phase
-    
+    const MaterialEntry* me = probe_material(pos);
+    const PawnEntry* pe = probe_pawns(pos);
+
+    assert(incremental_ok(pos));
+
     // Lambda to eval one side
-    auto eval_side = [&](Color c, Bitboard my_p, Bitboard op_p) -> Term {
+    auto eval_side = [&](Color c, Bitboard my_p) -> Term {
         Term t;
         Bitboard occupied = all;
-        
-        // Pieces
-        for(int pt=1; pt<PIECE_TYPE_NB; ++pt) {
+
+        // Mobility (material and PSQT are kept incrementally in StateInfo)
+        for(int pt=KNIGHT; pt<=QUEEN; ++pt) {
             Bitboard b = pos.pieces(c, static_cast<PieceType>(pt));
             while(b) {
                 Square s = Bitboards::pop_lsb(b);
-                int idx = (c==WHITE) ? s : (s^56);
-                
-                // Material + PSQT
-                t.add(W.Mat[pt][0] + W.PSQT[pt][idx][0], 
-                      W.Mat[pt][1] + W.PSQT[pt][idx][1]);
-                
-                // Phase
-                if (pt == KNIGHT || pt == BISHOP) phase += 1;
-                else if (pt == ROOK) phase += 2;
-                else if (pt == QUEEN) phase += 4;
-                
-                // Mobility
-                if (pt != PAWN && pt != KING) {
-                    Bitboard att = 0;
-                    if(pt == KNIGHT) att = Bitboards::knight_attacks(s);
-                    else if(pt == BISHOP) att = Bitboards::bishop_attacks(s, occupied);
-                    else if(pt == ROOK) att = Bitboards::rook_attacks(s, occupied);
-                    else if(pt == QUEEN) att = Bitboards::queen_attacks(s, occupied);
-                    
-                    // Safe mobility (not attacking our own, maybe controlled squares?)
-                    // Simplified: just count available squares
-                    att &= ~my_p; 
-                    int mob = Bitboards::count(att);
-                    t.add(mob * W.Mob[pt][0], mob * W.Mob[pt][1]);
-                }
+                Bitboard att = 0;
+                if(pt == KNIGHT) att = Bitboards::knight_attacks(s);
+                else if(pt == BISHOP) att = Bitboards::bishop_attacks(s, occupied);
+                else if(pt == ROOK) att = Bitboards::rook_attacks(s, occupied);
+                else att = Bitboards::queen_attacks(s, occupied);
+
+                // Safe mobility (not attacking our own, maybe controlled squares?)
+                // Simplified: just count available squares
+                att &= ~my_p;
+                int mob = Bitboards::count(att);
+                t.add(mob * W.Mob[pt][0], mob * W.Mob[pt][1]);
             }
         }
         return t;
     };
-    
-    Term us_term = eval_side(us, us_pieces, them_pieces);
-    Term them_term = eval_side(them, them_pieces, us_pieces);
-    
+
+    Term us_term = eval_side(us, us_pieces);
+    Term them_term = eval_side(them, them_pieces);
+
     score = us_term - them_term;
-    
-    // Pawn Structure
-    score.add(eval_pawns<WHITE>(pos)); // Technically needs logic to handle Us vs Them perspective properly
-    // For simplicity here:
-    // We need eval_pawns to return score relative to White, then flip for Black?
-    // Let's rely on standard material diff for now to save tokens/complexity in this snippet.
+
+    // Material + PSQT (incremental), pawn structure and material imbalance
+    // (cached), all from White's point of view
+    Score inc = pos.material_score() + pos.pst_score();
+    Term white = {mg_value(inc) + pe->mg + me->mg, eg_value(inc) + pe->eg + me->eg};
+    if (us == WHITE) score.add(white); else score.sub(white);
     
     // King Safety
     auto safety = [&](Color c) -> int {
@@ -277,8 +421,12 @@ int evaluate(const Position& pos) {
     };
     
     // Interpolate
-    int mg_phase = std::min(phase, MAX_PHASE);
+    int mg_phase = std::min(pos.game_phase(), MAX_PHASE);
     int eg_phase = MAX_PHASE - mg_phase;
+
+    // Drawish material: scale down the endgame score of the side ahead
+    Color strong = score.eg > 0 ? us : them;
+    score.eg = score.eg * me->scale[strong] / 64;
     
     int val = (score.mg * mg_phase + score.eg * eg_phase) / MAX_PHASE;
     
@@ -290,7 +438,12 @@ int evaluate(const Position& pos) {
 
 std::string trace(const Position& pos) {
     std::stringstream ss;
-    ss << "Eval: " << evaluate(pos);
+    ss << "Eval: " << evaluate(pos) << "\n";
+    CacheStats total = cache_stats();
+    ss << "Pawn cache: " << total.pawn_hits << "/" << total.pawn_probes << " hits ("
+       << (total.pawn_probes ? 100.0 * total.pawn_hits / total.pawn_probes : 0.0) << "%)\n";
+    ss << "Material cache: " << total.material_hits << "/" << total.material_probes << " hits ("
+       << (total.material_probes ? 100.0 * total.material_hits / total.material_probes : 0.0) << "%)";
     return ss.str();
 }
 
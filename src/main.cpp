@@ -2,11 +2,17 @@
 #include "bitboard.h"
 #include "zobrist.h"
 #include "tune.h"
+#include "evaluate.h"
+#include "search.h"
+#include "ucioption.h"
 
 int main() {
     Bitboards::init();
     Zobrist::init();
     Tune::init();
+    ClercX::Options.init();
+    Eval::init();
+    Search::init();
     
     UCI::loop();
     
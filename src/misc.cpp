@@ -1,11 +1,123 @@
 #include "misc.h"
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
 
 namespace Misc {
-    static std::mutex log_mutex;
 
-    void log(const std::string& msg) {
-        std::lock_guard<std::mutex> lock(log_mutex);
-        std::cout << "info string " << msg << std::endl;
+namespace {
+
+// Intrusive MPSC queue (Vyukov): a push is one exchange and one store, so
+// searching threads never wait on each other or on the writer. The
+// consumer owns 'tail' and always keeps one node (the stub) behind it.
+struct Node {
+    std::atomic<Node*> next{nullptr};
+    std::string line;
+};
+
+class OutputQueue {
+public:
+    OutputQueue() : head(&stub), tail(&stub) {
+        writer = std::thread(&OutputQueue::write_loop, this);
+    }
+
+    ~OutputQueue() {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            exit = true;
+        }
+        cv.notify_one();
+        writer.join();
+    }
+
+    void push(std::string line) {
+        Node* n = new Node;
+        n->line = std::move(line);
+        Node* prev = head.exchange(n, std::memory_order_acq_rel);
+        // Store-then-load against the writer's sleeping store and empty()
+        // re-check: with all four seq_cst, either we see it sleeping or it
+        // sees the new node, so a line is never left behind a sleeping writer.
+        // Notifying under the mutex cannot fall between its check and wait.
+        prev->next.store(n, std::memory_order_seq_cst);
+        pushed.fetch_add(1, std::memory_order_release);
+
+        if (sleeping.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lk(mutex);
+            cv.notify_one();
+        }
+    }
+
+    void flush() {
+        uint64_t target = pushed.load(std::memory_order_acquire);
+        while (written.load(std::memory_order_acquire) < target) std::this_thread::yield();
+    }
+
+private:
+    // Only used on the way to sleep; seq_cst pairs with push()
+    bool empty() const { return tail->next.load(std::memory_order_seq_cst) == nullptr; }
+
+    // Pops everything linked so far into one buffer, then writes and
+    // flushes it with a single call
+    void write_loop() {
+        std::string batch;
+        while (true) {
+            uint64_t count = 0;
+            Node* next;
+            while ((next = tail->next.load(std::memory_order_acquire)) != nullptr) {
+                batch += next->line;
+                batch += '\n';
+                if (tail != &stub) delete tail;
+                tail = next;
+                ++count;
+            }
+
+            if (count) {
+                std::cout.write(batch.data(), batch.size());
+                std::cout.flush();
+                batch.clear();
+                written.fetch_add(count, std::memory_order_release);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lk(mutex);
+            sleeping.store(true, std::memory_order_seq_cst);
+            cv.wait(lk, [this] { return exit || !empty(); });
+            sleeping.store(false, std::memory_order_relaxed);
+            if (exit && empty()) break;
+        }
+        if (tail != &stub) delete tail;
     }
+
+    Node stub;
+    std::atomic<Node*> head;
+    Node* tail;
+    std::atomic<uint64_t> pushed{0}, written{0};
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<bool> sleeping{false};
+    bool exit = false;
+};
+
+OutputQueue& output() {
+    static OutputQueue queue; // Writer thread starts with the first line
+    return queue;
+}
+
+} // namespace
+
+void out(std::string line) {
+    output().push(std::move(line));
+}
+
+void flush_out() {
+    output().flush();
+}
+
+void log(const std::string& msg) {
+    out("info string " + msg);
+}
+
 }
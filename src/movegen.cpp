@@ -2,165 +2,235 @@
 
 namespace MoveGen {
 
-template<GenType T>
-void generate(const Position& pos, MoveList& moves) {
+namespace {
+
+void add_promotions(MoveList& moves, Square from, Square to) {
+    moves.add(Move(from, to, PROMOTION, QUEEN));
+    moves.add(Move(from, to, PROMOTION, ROOK));
+    moves.add(Move(from, to, PROMOTION, BISHOP));
+    moves.add(Move(from, to, PROMOTION, KNIGHT));
+}
+
+// Pawns - iterate per-pawn to ensure correct EP, promotions and double-push logic.
+// Pushes may only land on push_mask, captures only on capture_mask.
+void generate_pawn_moves(const Position& pos, MoveList& moves, Bitboard push_mask, Bitboard capture_mask, bool with_ep) {
     Color us = pos.side_to_move();
     Color them = static_cast<Color>(us ^ 1);
-    Bitboard occupied = pos.all_pieces();
     Bitboard enemies = pos.pieces(them);
-    Bitboard targets = (T == CAPTURES) ? enemies : (T == QUIETS) ? ~occupied : ~pos.pieces(us);
 
-    // Pawns - iterate per-pawn to ensure correct EP, promotions and double-push logic
-    Bitboard pawns = pos.pieces(us, PAWN);
     Direction up = (us == WHITE) ? NORTH : SOUTH;
     Bitboard rank2 = (us == WHITE) ? 0x000000000000FF00ULL : 0x00FF000000000000ULL; // pawns that can double
     Bitboard rank7 = (us == WHITE) ? 0x00FF000000000000ULL : 0x000000000000FF00ULL; // pawns that promote on next move
 
-    Bitboard b = pawns;
+    Bitboard b = pos.pieces(us, PAWN);
     Square ep_sq = pos.state_ptr()->ep_square;
 
     while (b) {
         Square from = Bitboards::pop_lsb(b);
-        int t1 = static_cast<int>(from) + up;
-
-        // Single push / promotion by push (validate board indices)
-        if (t1 >= 0 && t1 < SQ_NB && T != CAPTURES) {
-            Square to1 = static_cast<Square>(t1);
-            if (pos.piece_on(to1) == NO_PIECE) {
-                if (Bitboards::square_bb(from) & rank7) {
-                    moves.add(Move(from, to1, PROMOTION, QUEEN));
-                    moves.add(Move(from, to1, PROMOTION, ROOK));
-                    moves.add(Move(from, to1, PROMOTION, BISHOP));
-                    moves.add(Move(from, to1, PROMOTION, KNIGHT));
-                } else {
-                    moves.add(Move(from, to1));
-
-                    // Double push
-                    if ((Bitboards::square_bb(from) & rank2) != 0) {
-                        int t2 = static_cast<int>(from) + 2 * up;
-                        if (t2 >= 0 && t2 < SQ_NB) {
-                            Square to2 = static_cast<Square>(t2);
-                            if (pos.piece_on(to2) == NO_PIECE && pos.piece_on(to1) == NO_PIECE) {
-                                moves.add(Move(from, to2));
-                            }
-                        }
-                    }
+        bool promotes = Bitboards::square_bb(from) & rank7;
+
+        // Single push / promotion by push. A pawn never stands on its last rank,
+        // so from + up is always on the board.
+        Square to1 = static_cast<Square>(from + up);
+        if (pos.piece_on(to1) == NO_PIECE) {
+            if (push_mask & Bitboards::square_bb(to1)) {
+                if (promotes) add_promotions(moves, from, to1);
+                else moves.add(Move(from, to1));
+            }
+
+            // Double push
+            if (Bitboards::square_bb(from) & rank2) {
+                Square to2 = static_cast<Square>(from + 2 * up);
+                if (pos.piece_on(to2) == NO_PIECE && (push_mask & Bitboards::square_bb(to2))) {
+                    moves.add(Move(from, to2));
                 }
             }
         }
 
         // Captures (including promotions)
         Bitboard attacks = Bitboards::pawn_attacks(from, us);
-        Bitboard caps = attacks & enemies;
-        Bitboard tmp = caps;
-        while (tmp) {
-            Square to = Bitboards::pop_lsb(tmp);
-            if (Bitboards::square_bb(from) & rank7) {
-                moves.add(Move(from, to, PROMOTION, QUEEN));
-                moves.add(Move(from, to, PROMOTION, ROOK));
-                moves.add(Move(from, to, PROMOTION, BISHOP));
-                moves.add(Move(from, to, PROMOTION, KNIGHT));
-            } else {
-                moves.add(Move(from, to));
-            }
+        Bitboard caps = attacks & enemies & capture_mask;
+        while (caps) {
+            Square to = Bitboards::pop_lsb(caps);
+            if (promotes) add_promotions(moves, from, to);
+            else moves.add(Move(from, to));
         }
 
         // En passant
-        if (ep_sq != SQ_NONE && (attacks & Bitboards::square_bb(ep_sq))) {
-            // EP is a capture type - generate only when captures allowed
-            if (T != QUIETS) {
-                moves.add(Move(from, ep_sq, EN_PASSANT));
-            }
+        if (with_ep && ep_sq != SQ_NONE && (attacks & Bitboards::square_bb(ep_sq))) {
+            moves.add(Move(from, ep_sq, EN_PASSANT));
         }
     }
+}
 
-    // Knights
-    Bitboard knights = pos.pieces(us, KNIGHT);
-    while (knights) {
-        Square from = Bitboards::pop_lsb(knights);
-        Bitboard attacks = Bitboards::knight_attacks(from) & targets;
+template<PieceType Pt>
+void generate_piece_moves(const Position& pos, MoveList& moves, Bitboard target, Bitboard from_mask = ~0ULL) {
+    Bitboard occupied = pos.all_pieces();
+    Bitboard pieces = pos.pieces(pos.side_to_move(), Pt) & from_mask;
+    while (pieces) {
+        Square from = Bitboards::pop_lsb(pieces);
+        Bitboard attacks = (Pt == KNIGHT) ? Bitboards::knight_attacks(from)
+                         : (Pt == BISHOP) ? Bitboards::bishop_attacks(from, occupied)
+                         : (Pt == ROOK)   ? Bitboards::rook_attacks(from, occupied)
+                         :                  Bitboards::queen_attacks(from, occupied);
+        attacks &= target;
         while (attacks) {
             moves.add(Move(from, Bitboards::pop_lsb(attacks)));
         }
     }
+}
 
-    // Bishops
-    Bitboard bishops = pos.pieces(us, BISHOP);
-    while (bishops) {
-        Square from = Bitboards::pop_lsb(bishops);
-        Bitboard attacks = Bitboards::bishop_attacks(from, occupied) & targets;
-        while (attacks) {
-            moves.add(Move(from, Bitboards::pop_lsb(attacks)));
+void generate_castling(const Position& pos, MoveList& moves, Square from) {
+    Color us = pos.side_to_move();
+    Color them = static_cast<Color>(us ^ 1);
+    uint8_t castle = pos.state_ptr()->castle_rights;
+
+    // Castling: ensure rights, empty squares and not passing through/into check
+    if (us == WHITE) {
+        // King side
+        if ((castle & 1) != 0) {
+            if (pos.piece_on(SQ_F1) == NO_PIECE && pos.piece_on(SQ_G1) == NO_PIECE) {
+                if (!pos.is_attacked(SQ_F1, them) && !pos.is_attacked(SQ_G1, them)) {
+                    moves.add(Move(from, SQ_G1, CASTLING));
+                }
+            }
+        }
+        // Queen side
+        if ((castle & 2) != 0) {
+            if (pos.piece_on(SQ_B1) == NO_PIECE && pos.piece_on(SQ_C1) == NO_PIECE && pos.piece_on(SQ_D1) == NO_PIECE) {
+                if (!pos.is_attacked(SQ_D1, them) && !pos.is_attacked(SQ_C1, them)) {
+                    moves.add(Move(from, SQ_C1, CASTLING));
+                }
+            }
+        }
+    } else {
+        if ((castle & 4) != 0) {
+            if (pos.piece_on(SQ_F8) == NO_PIECE && pos.piece_on(SQ_G8) == NO_PIECE) {
+                if (!pos.is_attacked(SQ_F8, them) && !pos.is_attacked(SQ_G8, them)) {
+                    moves.add(Move(from, SQ_G8, CASTLING));
+                }
+            }
+        }
+        if ((castle & 8) != 0) {
+            if (pos.piece_on(SQ_B8) == NO_PIECE && pos.piece_on(SQ_C8) == NO_PIECE && pos.piece_on(SQ_D8) == NO_PIECE) {
+                if (!pos.is_attacked(SQ_D8, them) && !pos.is_attacked(SQ_C8, them)) {
+                    moves.add(Move(from, SQ_C8, CASTLING));
+                }
+            }
         }
     }
+}
 
-    // Rooks
-    Bitboard rooks = pos.pieces(us, ROOK);
-    while (rooks) {
-        Square from = Bitboards::pop_lsb(rooks);
-        Bitboard attacks = Bitboards::rook_attacks(from, occupied) & targets;
-        while (attacks) {
-            moves.add(Move(from, Bitboards::pop_lsb(attacks)));
+} // namespace
+
+template<GenType T>
+void generate(const Position& pos, MoveList& moves) {
+    if (T == LEGAL) {
+        // Pseudo-legal moves (evasions when in check), then drop the few that
+        // can still expose the king: king moves, en passant and pinned pieces.
+        Color us = pos.side_to_move();
+        Square ksq = pos.king_square(us);
+        Bitboard pinned = pos.pinned(us);
+        int first = moves.count;
+
+        if (pos.checkers()) generate<EVASIONS>(pos, moves);
+        else generate<ALL>(pos, moves);
+
+        for (int i = first; i < moves.count; ) {
+            Move m = moves[i];
+            if (((pinned & Bitboards::square_bb(m.from())) || m.from() == ksq || m.type() == EN_PASSANT)
+                && !pos.is_legal(m))
+                moves[i] = moves[--moves.count];
+            else
+                ++i;
         }
+        return;
     }
 
-    // Queens
-    Bitboard queens = pos.pieces(us, QUEEN);
-    while (queens) {
-        Square from = Bitboards::pop_lsb(queens);
-        Bitboard attacks = Bitboards::queen_attacks(from, occupied) & targets;
+    Color us = pos.side_to_move();
+    Color them = static_cast<Color>(us ^ 1);
+    Bitboard occupied = pos.all_pieces();
+    Bitboard enemies = pos.pieces(them);
+    Square ksq = pos.king_square(us);
+
+    if (T == QUIET_CHECKS) {
+        // Pieces only reach their check squares; discovered-check candidates
+        // may go anywhere. Pawn pushes, promotions, king moves and castling
+        // are generated in full and filtered with gives_check().
+        Bitboard empty = ~occupied;
+        Bitboard dc = pos.discovered_check_candidates();
+        int first = moves.count;
+
+        generate_pawn_moves(pos, moves, empty, 0, false);
+        generate_piece_moves<KNIGHT>(pos, moves, empty & pos.check_squares(KNIGHT), ~dc);
+        generate_piece_moves<BISHOP>(pos, moves, empty & pos.check_squares(BISHOP), ~dc);
+        generate_piece_moves<ROOK>(pos, moves, empty & pos.check_squares(ROOK), ~dc);
+        generate_piece_moves<QUEEN>(pos, moves, empty & pos.check_squares(QUEEN), ~dc);
+        generate_piece_moves<KNIGHT>(pos, moves, empty, dc);
+        generate_piece_moves<BISHOP>(pos, moves, empty, dc);
+        generate_piece_moves<ROOK>(pos, moves, empty, dc);
+        generate_piece_moves<QUEEN>(pos, moves, empty, dc);
+
+        if (ksq != SQ_NONE) {
+            if (dc & Bitboards::square_bb(ksq)) {
+                Bitboard attacks = Bitboards::king_attacks(ksq) & empty;
+                while (attacks) moves.add(Move(ksq, Bitboards::pop_lsb(attacks)));
+            }
+            generate_castling(pos, moves, ksq);
+        }
+
+        for (int i = first; i < moves.count; ) {
+            if (!pos.gives_check(moves[i])) moves[i] = moves[--moves.count];
+            else ++i;
+        }
+        return;
+    }
+
+    if (T == EVASIONS) {
+        Bitboard checkers = pos.checkers();
+
+        // With a single checker, other pieces may capture it or block the line
+        if (!Bitboards::more_than_one(checkers)) {
+            Square checker = Bitboards::lsb(checkers);
+            Bitboard block = Bitboards::between(ksq, checker);
+            Bitboard target = block | checkers;
+
+            generate_pawn_moves(pos, moves, block, checkers, true);
+            generate_piece_moves<KNIGHT>(pos, moves, target);
+            generate_piece_moves<BISHOP>(pos, moves, target);
+            generate_piece_moves<ROOK>(pos, moves, target);
+            generate_piece_moves<QUEEN>(pos, moves, target);
+        }
+
+        // King steps; legality of the destination is left to is_legal()
+        Bitboard attacks = Bitboards::king_attacks(ksq) & ~pos.pieces(us);
         while (attacks) {
-            moves.add(Move(from, Bitboards::pop_lsb(attacks)));
+            moves.add(Move(ksq, Bitboards::pop_lsb(attacks)));
         }
+        return;
     }
 
+    Bitboard targets = (T == CAPTURES) ? enemies : (T == QUIETS) ? ~occupied : ~pos.pieces(us);
+
+    // EP is a capture type - generate only when captures allowed
+    generate_pawn_moves(pos, moves,
+                        T == CAPTURES ? 0 : ~occupied,
+                        T == QUIETS ? 0 : enemies,
+                        T != QUIETS);
+    generate_piece_moves<KNIGHT>(pos, moves, targets);
+    generate_piece_moves<BISHOP>(pos, moves, targets);
+    generate_piece_moves<ROOK>(pos, moves, targets);
+    generate_piece_moves<QUEEN>(pos, moves, targets);
+
     // King (including castling generation)
-    Bitboard king = pos.pieces(us, KING);
-    if (king) {
-        Square from = Bitboards::lsb(king);
-        Bitboard attacks = Bitboards::king_attacks(from) & targets;
+    if (ksq != SQ_NONE) {
+        Bitboard attacks = Bitboards::king_attacks(ksq) & targets;
         while (attacks) {
-            moves.add(Move(from, Bitboards::pop_lsb(attacks)));
+            moves.add(Move(ksq, Bitboards::pop_lsb(attacks)));
         }
 
-        // Castling: ensure rights, empty squares and not passing through/into check
-        uint8_t castle = pos.state_ptr()->castle_rights;
-        // Only add castling as quiet moves (not captures)
-        if (T != CAPTURES) {
-            if (us == WHITE) {
-                // King side
-                if ((castle & 1) != 0) {
-                    if (pos.piece_on(SQ_F1) == NO_PIECE && pos.piece_on(SQ_G1) == NO_PIECE) {
-                        if (!pos.is_attacked(from, them) && !pos.is_attacked(SQ_F1, them) && !pos.is_attacked(SQ_G1, them)) {
-                            moves.add(Move(from, SQ_G1, CASTLING));
-                        }
-                    }
-                }
-                // Queen side
-                if ((castle & 2) != 0) {
-                    if (pos.piece_on(SQ_B1) == NO_PIECE && pos.piece_on(SQ_C1) == NO_PIECE && pos.piece_on(SQ_D1) == NO_PIECE) {
-                        if (!pos.is_attacked(from, them) && !pos.is_attacked(SQ_D1, them) && !pos.is_attacked(SQ_C1, them)) {
-                            moves.add(Move(from, SQ_C1, CASTLING));
-                        }
-                    }
-                }
-            } else {
-                if ((castle & 4) != 0) {
-                    if (pos.piece_on(SQ_F8) == NO_PIECE && pos.piece_on(SQ_G8) == NO_PIECE) {
-                        if (!pos.is_attacked(from, them) && !pos.is_attacked(SQ_F8, them) && !pos.is_attacked(SQ_G8, them)) {
-                            moves.add(Move(from, SQ_G8, CASTLING));
-                        }
-                    }
-                }
-                if ((castle & 8) != 0) {
-                    if (pos.piece_on(SQ_B8) == NO_PIECE && pos.piece_on(SQ_C8) == NO_PIECE && pos.piece_on(SQ_D8) == NO_PIECE) {
-                        if (!pos.is_attacked(from, them) && !pos.is_attacked(SQ_D8, them) && !pos.is_attacked(SQ_C8, them)) {
-                            moves.add(Move(from, SQ_C8, CASTLING));
-                        }
-                    }
-                }
-            }
-        }
+        // Only add castling as quiet moves (not captures), never out of check
+        if (T != CAPTURES && !pos.checkers()) generate_castling(pos, moves, ksq);
     }
 }
 
@@ -178,9 +248,15 @@ void generate(const Position& pos, std::vector<Move>& moves) {
 template void generate<ALL>(const Position& pos, MoveList& moves);
 template void generate<CAPTURES>(const Position& pos, MoveList& moves);
 template void generate<QUIETS>(const Position& pos, MoveList& moves);
+template void generate<EVASIONS>(const Position& pos, MoveList& moves);
+template void generate<QUIET_CHECKS>(const Position& pos, MoveList& moves);
+template void generate<LEGAL>(const Position& pos, MoveList& moves);
 
 template void generate<ALL>(const Position& pos, std::vector<Move>& moves);
 template void generate<CAPTURES>(const Position& pos, std::vector<Move>& moves);
 template void generate<QUIETS>(const Position& pos, std::vector<Move>& moves);
+template void generate<EVASIONS>(const Position& pos, std::vector<Move>& moves);
+template void generate<QUIET_CHECKS>(const Position& pos, std::vector<Move>& moves);
+template void generate<LEGAL>(const Position& pos, std::vector<Move>& moves);
 
 } // namespace MoveGen
@@ -8,6 +8,22 @@
 
 namespace Opt {
 
+Thread::Thread(int id) : id(id), searching(true) {
+    std_thread = std::thread(&Thread::idle_loop, this);
+    bind();
+    wait(); // Parked and ready
+}
+
+Thread::~Thread() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        exit = true;
+    }
+    cv.notify_all();
+    if (std_thread.joinable()) std_thread.join();
+}
+
 void Thread::bind() {
 #if defined(__linux__)
     cpu_set_t cpuset;
@@ -17,45 +33,65 @@ void Thread::bind() {
 #endif
 }
 
-ThreadPool::ThreadPool() : stop_flag(false) {}
+void Thread::run(std::function<void(int)> f) {
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        job = std::move(f);
+        searching = true;
+    }
+    cv.notify_all();
+}
+
+void Thread::wait() {
+    std::unique_lock<std::mutex> lk(mutex);
+    cv.wait(lk, [this] { return !searching; });
+}
+
+void Thread::idle_loop() {
+    while (true) {
+        std::function<void(int)> f;
+        {
+            std::unique_lock<std::mutex> lk(mutex);
+            searching = false;
+            cv.notify_all(); // Wake wait()
+            cv.wait(lk, [this] { return searching || exit; });
+            if (exit) return;
+            f = std::move(job);
+        }
+        f(id);
+    }
+}
+
+ThreadPool::ThreadPool() {}
 
 ThreadPool::~ThreadPool() {
     stop();
 }
 
 void ThreadPool::init(int num_threads) {
+    if (num_threads == size()) return;
     stop();
-    threads.clear();
     for (int i = 0; i < num_threads; ++i) {
         threads.push_back(std::make_unique<Thread>(i));
     }
 }
 
 void ThreadPool::start_search(std::function<void(int)> search_func) {
-    // Stop any existing search threads first (sanity check)
-    for(auto& t : threads) {
-        if(t->std_thread.joinable()) t->std_thread.join();
-    }
-
-    for (auto& t : threads) {
-        // Capture raw pointer to Thread object and function
-        Thread* t_ptr = t.get();
-        t_ptr->std_thread = std::thread([t_ptr, search_func]() {
-            t_ptr->bind();
-            search_func(t_ptr->id);
-        });
-    }
+    // A previous job must have finished before the workers are reused
+    wait_for_completion();
+    for (auto& t : threads) t->run(search_func);
 }
 
 void ThreadPool::wait_for_completion() {
-    stop();
+    for (auto& t : threads) t->wait();
+}
+
+void ThreadPool::wait_for_helpers() {
+    for (size_t i = 1; i < threads.size(); ++i) threads[i]->wait();
 }
 
 void ThreadPool::stop() {
-    stop_flag = true;
-    for(auto& t : threads) {
-        if(t->std_thread.joinable()) t->std_thread.join();
-    }
+    threads.clear(); // ~Thread waits for its job, then exits and joins
 }
 
-}
\ No newline at end of file
+}
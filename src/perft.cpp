@@ -0,0 +1,189 @@
+#include "perft.h"
+#include "movegen.h"
+#include "mcache.h"
+#include "tune.h"
+#include "misc.h"
+#include "opt/mthread.h"
+#include <atomic>
+#include <sstream>
+#include <vector>
+
+namespace Perft {
+
+namespace {
+
+// --- Perft Hash ---
+// Lockless: 'check' holds key ^ nodes, so an entry torn by two writers
+// fails verification instead of returning another subtree's count.
+
+struct PerftEntry {
+    uint64_t check;
+    uint64_t nodes;
+};
+
+MCache::CacheTable<PerftEntry, 1 << 20>& hash_table() {
+    static MCache::CacheTable<PerftEntry, 1 << 20> table; // 16MB, allocated on first use
+    return table;
+}
+
+uint64_t hash_key(const Position& pos, int depth) {
+    return pos.hash() ^ (static_cast<uint64_t>(depth) * 0x9E3779B97F4A7C15ULL);
+}
+
+struct Entry {
+    const char* fen;
+    int depth;
+    uint64_t nodes;
+};
+
+// Standard positions plus edge cases for en passant, castling and promotion
+const Entry Suite[] = {
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609 },
+    { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603 }, // Kiwipete
+    { "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624 },
+    { "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333 },
+    { "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 4, 422333 },
+    { "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487 },
+    { "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594 },
+    { "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888 },
+    { "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133 },
+    { "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467 },
+    { "5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072 },
+    { "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711 },
+    { "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206 },
+    { "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476 },
+    { "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001 },
+    { "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658 },
+    { "4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342 },
+    { "8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683 },
+    { "K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217 },
+    { "8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584 },
+    { "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527 },
+};
+
+// Counts below every root move, splitting the root list across the pool
+std::vector<uint64_t> split(const Position& pos, const MoveGen::MoveList& roots, int depth, bool use_hash) {
+    std::vector<uint64_t> counts(roots.count, 0);
+    std::atomic<int> next{0};
+
+    int threads = std::max(1, std::min(Tune::get("Threads"), static_cast<int>(roots.count)));
+    Opt::ThreadPool pool;
+    pool.init(threads);
+    pool.start_search([&](int) {
+        Position p = pos;
+        int i;
+        while ((i = next.fetch_add(1)) < roots.count) {
+            StateInfo st;
+            p.make_move(roots[i], st);
+            counts[i] = perft(p, depth - 1, use_hash);
+            p.unmake_move(roots[i]);
+        }
+    });
+    pool.wait_for_completion();
+    return counts;
+}
+
+void report(uint64_t nodes, uint64_t ms) {
+    Misc::out("Nodes searched: " + std::to_string(nodes));
+    Misc::out("Time (ms): " + std::to_string(ms));
+    Misc::out("Nodes/second: " + std::to_string(nodes * 1000 / std::max<uint64_t>(ms, 1)));
+}
+
+} // namespace
+
+uint64_t perft(Position& pos, int depth, bool use_hash) {
+    MoveGen::MoveList moves;
+    MoveGen::generate<MoveGen::LEGAL>(pos, moves);
+    if (depth <= 1) return depth == 1 ? moves.count : 1;
+
+    uint64_t key = 0;
+    if (use_hash && depth > 2) {
+        key = hash_key(pos, depth);
+        PerftEntry e = *hash_table()[key];
+        if ((e.check ^ e.nodes) == key) return e.nodes;
+    }
+
+    uint64_t nodes = 0;
+    for (Move m : moves) {
+        StateInfo st;
+        pos.make_move(m, st);
+        nodes += perft(pos, depth - 1, use_hash);
+        pos.unmake_move(m);
+    }
+
+    if (use_hash && depth > 2) {
+        PerftEntry* e = hash_table()[key];
+        e->nodes = nodes;
+        e->check = key ^ nodes;
+    }
+    return nodes;
+}
+
+void go(const Position& pos, int depth, bool use_hash) {
+    if (use_hash) hash_table().clear();
+
+    uint64_t start = Misc::now();
+    MoveGen::MoveList roots;
+    MoveGen::generate<MoveGen::LEGAL>(pos, roots);
+
+    uint64_t nodes = 0;
+    if (depth <= 1) nodes = depth == 1 ? roots.count : 1;
+    else for (uint64_t n : split(pos, roots, depth, use_hash)) nodes += n;
+
+    report(nodes, Misc::now() - start);
+}
+
+void divide(const Position& pos, int depth, bool use_hash) {
+    if (use_hash) hash_table().clear();
+
+    uint64_t start = Misc::now();
+    MoveGen::MoveList roots;
+    MoveGen::generate<MoveGen::LEGAL>(pos, roots);
+    depth = std::max(depth, 1);
+
+    std::vector<uint64_t> counts = depth == 1 ? std::vector<uint64_t>(roots.count, 1)
+                                              : split(pos, roots, depth, use_hash);
+    uint64_t nodes = 0;
+    for (int i = 0; i < roots.count; ++i) {
+        Misc::out(roots[i].to_string() + ": " + std::to_string(counts[i]));
+        nodes += counts[i];
+    }
+    Misc::out("");
+    report(nodes, Misc::now() - start);
+}
+
+bool suite() {
+    uint64_t total_nodes = 0, total_ms = 0;
+    int failures = 0;
+
+    for (const Entry& e : Suite) {
+        Position pos;
+        pos.set_fen(e.fen);
+
+        uint64_t start = Misc::now();
+        MoveGen::MoveList roots;
+        MoveGen::generate<MoveGen::LEGAL>(pos, roots);
+        uint64_t nodes = 0;
+        for (uint64_t n : split(pos, roots, e.depth, false)) nodes += n;
+        uint64_t ms = Misc::now() - start;
+
+        bool ok = nodes == e.nodes;
+        if (!ok) failures++;
+        total_nodes += nodes;
+        total_ms += ms;
+
+        std::ostringstream line;
+        line << (ok ? "ok   " : "FAIL ") << "depth " << e.depth << " nodes " << nodes;
+        if (!ok) line << " (expected " << e.nodes << ")";
+        line << " nps " << (nodes * 1000 / std::max<uint64_t>(ms, 1)) << "  " << e.fen;
+        Misc::out(line.str());
+    }
+
+    Misc::out("");
+    Misc::out((failures ? "FAILED " : "passed ") + std::to_string(sizeof(Suite) / sizeof(Suite[0]) - failures)
+              + "/" + std::to_string(sizeof(Suite) / sizeof(Suite[0])));
+    report(total_nodes, total_ms);
+    return failures == 0;
+}
+
+} // namespace Perft
@@ -1,5 +1,6 @@
 #include "position.h"
 #include "zobrist.h"
+#include "evaluate.h"
 #include <sstream>
 #include <vector>
 #include <algorithm>
@@ -21,8 +22,14 @@ void Position::clear() {
     state->ep_square = SQ_NONE;
     state->halfmove_clock = 0;
     state->key = 0;
-    state->material_score = 0; 
-    state->pst_score = 0;      
+    state->pawn_key = 0;
+    state->material_key = 0;
+    state->material_score = SCORE_ZERO;
+    state->pst_score = SCORE_ZERO;
+    state->phase = 0;
+    state->checkers = 0;
+    state->blockers[WHITE] = state->blockers[BLACK] = 0;
+    state->pinners[WHITE] = state->pinners[BLACK] = 0;
     state->previous = nullptr;
     history_index = 0;
     
@@ -35,17 +42,51 @@ void Position::put_piece(Piece p, Square s) {
     color_bb[color_of(p)] |= b;
     type_bb[type_of(p)] |= b;
     state->key ^= Zobrist::piece_keys[p][s];
+    if (type_of(p) == PAWN) state->pawn_key ^= Zobrist::piece_keys[p][s];
+    state->material_key ^= Zobrist::material_keys[p][Bitboards::count(pieces(color_of(p), type_of(p)))];
+    state->material_score += Eval::PieceMaterial[p];
+    state->pst_score += Eval::PieceSquare[p][s];
+    state->phase += Eval::PhaseWeight[type_of(p)];
 }
 
 void Position::remove_piece(Square s) {
     Piece p = board[s];
     Bitboard b = Bitboards::square_bb(s);
+    state->material_key ^= Zobrist::material_keys[p][Bitboards::count(pieces(color_of(p), type_of(p)))];
+    if (type_of(p) == PAWN) state->pawn_key ^= Zobrist::piece_keys[p][s];
+    state->material_score -= Eval::PieceMaterial[p];
+    state->pst_score -= Eval::PieceSquare[p][s];
+    state->phase -= Eval::PhaseWeight[type_of(p)];
     color_bb[color_of(p)] &= ~b;
     type_bb[type_of(p)] &= ~b;
     board[s] = NO_PIECE;
     state->key ^= Zobrist::piece_keys[p][s];
 }
 
+void Position::set_square(Piece p, Square s) {
+    board[s] = p;
+    Bitboard b = Bitboards::square_bb(s);
+    color_bb[color_of(p)] |= b;
+    type_bb[type_of(p)] |= b;
+}
+
+void Position::clear_square(Square s) {
+    Piece p = board[s];
+    Bitboard b = Bitboards::square_bb(s);
+    color_bb[color_of(p)] &= ~b;
+    type_bb[type_of(p)] &= ~b;
+    board[s] = NO_PIECE;
+}
+
+void Position::move_piece(Square from, Square to) {
+    Piece p = board[from];
+    Bitboard b = Bitboards::square_bb(from) | Bitboards::square_bb(to);
+    color_bb[color_of(p)] ^= b;
+    type_bb[type_of(p)] ^= b;
+    board[from] = NO_PIECE;
+    board[to] = p;
+}
+
 bool Position::is_attacked(Square s, Color attacker) const {
     Bitboard occupied = all_pieces();
     if (Bitboards::pawn_attacks(s, static_cast<Color>(attacker ^ 1)) & pieces(attacker, PAWN)) return true;
@@ -56,6 +97,65 @@ bool Position::is_attacked(Square s, Color attacker) const {
     return false;
 }
 
+// All pieces of both colours attacking s, given an occupancy that may differ
+// from the board (SEE removes pieces as the exchange proceeds).
+Bitboard Position::attackers_to(Square s, Bitboard occupied) const {
+    return (Bitboards::pawn_attacks(s, BLACK) & pieces(WHITE, PAWN))
+         | (Bitboards::pawn_attacks(s, WHITE) & pieces(BLACK, PAWN))
+         | (Bitboards::knight_attacks(s) & type_bb[KNIGHT])
+         | (Bitboards::bishop_attacks(s, occupied) & (type_bb[BISHOP] | type_bb[QUEEN]))
+         | (Bitboards::rook_attacks(s, occupied) & (type_bb[ROOK] | type_bb[QUEEN]))
+         | (Bitboards::king_attacks(s) & type_bb[KING]);
+}
+
+// Pieces standing alone between s and one of the given sliders. pinners
+// receives the sliders whose single blocker has the colour of the piece on s.
+Bitboard Position::slider_blockers(Bitboard sliders, Square s, Bitboard& pinners) const {
+    Bitboard blockers = 0;
+    pinners = 0;
+
+    Bitboard snipers = ((Bitboards::rook_attacks(s, 0) & (type_bb[ROOK] | type_bb[QUEEN]))
+                      | (Bitboards::bishop_attacks(s, 0) & (type_bb[BISHOP] | type_bb[QUEEN]))) & sliders;
+    Bitboard occupancy = all_pieces() ^ snipers;
+
+    while (snipers) {
+        Square sniper = Bitboards::pop_lsb(snipers);
+        Bitboard b = Bitboards::between(s, sniper) & occupancy;
+        if (b && !Bitboards::more_than_one(b)) {
+            blockers |= b;
+            if (b & pieces(color_of(board[s]))) pinners |= Bitboards::square_bb(sniper);
+        }
+    }
+    return blockers;
+}
+
+void Position::set_check_info() {
+    Color them = static_cast<Color>(side ^ 1);
+    Square ksq = king_square(side);
+
+    state->checkers = (ksq != SQ_NONE) ? attackers_to(ksq, all_pieces()) & pieces(them) : 0;
+
+    for (int c = 0; c < COLOR_NB; ++c) {
+        Color col = static_cast<Color>(c);
+        Square k = king_square(col);
+        state->blockers[c] = state->pinners[c ^ 1] = 0;
+        if (k != SQ_NONE)
+            state->blockers[c] = slider_blockers(pieces(static_cast<Color>(c ^ 1)), k, state->pinners[c ^ 1]);
+    }
+
+    Square eksq = king_square(them);
+    if (eksq == SQ_NONE) {
+        for (Bitboard& b : state->check_squares) b = 0;
+        return;
+    }
+    state->check_squares[PAWN]   = Bitboards::pawn_attacks(eksq, them);
+    state->check_squares[KNIGHT] = Bitboards::knight_attacks(eksq);
+    state->check_squares[BISHOP] = Bitboards::bishop_attacks(eksq, all_pieces());
+    state->check_squares[ROOK]   = Bitboards::rook_attacks(eksq, all_pieces());
+    state->check_squares[QUEEN]  = state->check_squares[BISHOP] | state->check_squares[ROOK];
+    state->check_squares[KING]   = 0;
+}
+
 bool Position::is_draw() const {
     if (state->halfmove_clock >= 100) return true;
     if (is_repetition()) return true;
@@ -114,17 +214,6 @@ bool Position::is_pseudo_legal(Move m) const {
     
     if (type_of(p) == PAWN) {
         Direction up = (side == WHITE) ? NORTH : SOUTH;
-        if (type == PROMOTION || type == NORMAL) {
-            if (to == from + up) return board[to] == NO_PIECE;
-            if ((side == WHITE && from >= SQ_A2 && from <= SQ_H2 && to == from + up + up) ||
-                (side == BLACK && from >= SQ_A7 && from <= SQ_H7 && to == from + up + up)) {
-                return board[from + up] == NO_PIECE && board[to] == NO_PIECE;
-            }
-            if (Bitboards::pawn_attacks(from, side) & Bitboards::square_bb(to)) {
-                if (board[to] != NO_PIECE) return color_of(board[to]) != side;
-                if (to == state->ep_square) return true;
-            }
-        }
         if (type == EN_PASSANT) {
             // Must target EP square
             if (to != state->ep_square) return false;
@@ -132,9 +221,26 @@ bool Position::is_pseudo_legal(Move m) const {
             if (!((Bitboards::pawn_attacks(from, side) & Bitboards::square_bb(to)))) return false;
             return true;
         }
+        if (type == CASTLING) return false;
+
+        // Stale killer/TT moves: the move type must match the destination rank
+        bool last_rank = (to / 8 == 0) || (to / 8 == 7);
+        if ((type == PROMOTION) != last_rank) return false;
+
+        if (to == from + up) return board[to] == NO_PIECE;
+        if ((side == WHITE && from >= SQ_A2 && from <= SQ_H2 && to == from + up + up) ||
+            (side == BLACK && from >= SQ_A7 && from <= SQ_H7 && to == from + up + up)) {
+            return board[from + up] == NO_PIECE && board[to] == NO_PIECE;
+        }
+        if (Bitboards::pawn_attacks(from, side) & Bitboards::square_bb(to)) {
+            return board[to] != NO_PIECE;
+        }
         return false;
     }
-    
+
+    // Only pawns promote or capture en passant
+    if (type == PROMOTION || type == EN_PASSANT) return false;
+
     if (type == CASTLING) {
         if (type_of(p) != KING) return false;
         
@@ -172,78 +278,165 @@ bool Position::is_pseudo_legal(Move m) const {
 }
 
 bool Position::is_legal(Move m) const {
-    if (!is_pseudo_legal(m)) return false;
-    
-    // Castling special checks (cannot castle out of, through, or into check)
+    Color us = side;
+    Color them = static_cast<Color>(us ^ 1);
+    Square from = m.from();
+    Square to = m.to();
+    Square ksq = king_square(us);
+
     if (m.type() == CASTLING) {
-        Square from = m.from();
-        Square to = m.to();
-        Color us = side;
-        Color them = static_cast<Color>(us ^ 1);
-        
-        if (is_attacked(from, them)) return false; // Cannot castle out of check
-        
-        if (us == WHITE) {
-            if (to == SQ_G1) {
-                if (is_attacked(SQ_F1, them) || is_attacked(SQ_G1, them)) return false;
-            } else if (to == SQ_C1) {
-                if (is_attacked(SQ_D1, them) || is_attacked(SQ_C1, them)) return false;
-            }
-        } else {
-            if (to == SQ_G8) {
-                if (is_attacked(SQ_F8, them) || is_attacked(SQ_G8, them)) return false;
-            } else if (to == SQ_C8) {
-                if (is_attacked(SQ_D8, them) || is_attacked(SQ_C8, them)) return false;
-            }
+        // Cannot castle out of, through, or into check
+        if (state->checkers) return false;
+        Direction step = (to > from) ? WEST : EAST;
+        for (Square s = to; s != from; s = static_cast<Square>(s + step))
+            if (is_attacked(s, them)) return false;
+        return true;
+    }
+
+    // The captured pawn is removed from a different square than 'to', which
+    // can open a rank or diagonal onto our king: test the resulting board.
+    // In check the capture must also take the checking pawn or block a
+    // single slider; a knight or other pawn checker is left standing.
+    if (m.type() == EN_PASSANT) {
+        Square cap = static_cast<Square>(us == WHITE ? to + SOUTH : to + NORTH);
+        if (state->checkers) {
+            if (Bitboards::more_than_one(state->checkers)) return false;
+            Square checker = Bitboards::lsb(state->checkers);
+            if (checker != cap && !(Bitboards::between(ksq, checker) & Bitboards::square_bb(to))) return false;
         }
+        Bitboard occupied = (all_pieces() ^ Bitboards::square_bb(from) ^ Bitboards::square_bb(cap))
+                          | Bitboards::square_bb(to);
+        return !(Bitboards::rook_attacks(ksq, occupied) & (pieces(them, ROOK) | pieces(them, QUEEN)))
+            && !(Bitboards::bishop_attacks(ksq, occupied) & (pieces(them, BISHOP) | pieces(them, QUEEN)));
     }
-    
-    // Try move and check if king is left in check
-    // We cannot use make_move/unmake_move here easily because make_move modifies 'state' pointer
-    // and requires a new StateInfo buffer. 
-    // Instead we do a light-weight check:
-    // 1. If King moves, check if dest is attacked.
-    // 2. If other moves, check if King is attacked.
-    
-    Square king_sq = Bitboards::lsb(pieces(side, KING));
+
+    // King moves: the destination must not be attacked once the king has
+    // left 'from' (so sliders checking along the line still count).
+    if (from == ksq)
+        return !(attackers_to(to, all_pieces() ^ Bitboards::square_bb(from)) & pieces(them));
+
+    // Other moves while in check must capture or block the single checker
+    if (state->checkers) {
+        if (Bitboards::more_than_one(state->checkers)) return false;
+        Square checker = Bitboards::lsb(state->checkers);
+        if (!((Bitboards::between(ksq, checker) | state->checkers) & Bitboards::square_bb(to))) return false;
+    }
+
+    // A pinned piece may only move along the pin line
+    return !(pinned(us) & Bitboards::square_bb(from)) || Bitboards::aligned(from, to, ksq);
+}
+
+bool Position::gives_check(Move m) const {
+    Color us = side;
+    Color them = static_cast<Color>(us ^ 1);
     Square from = m.from();
     Square to = m.to();
-    
-    if (type_of(board[from]) == KING) {
-        // King move
-        // If castling, we already checked.
-        if (m.type() != CASTLING) {
-            // Temporarily update occupancy to check attacks accurately?
-            // Actually, simply checking is_attacked(to) is almost enough, 
-            // EXCEPT for x-rays through the king's original position (rare but possible).
-            // But 'is_attacked' checks current board.
-            // If we move king, we need to know if 'to' is attacked on the *resulting* board.
-            // The safest way without full make_move is to verify attacks ignoring the king's old square.
-            // Standard engine approach: just make the move.
-            
-            StateInfo st;
-            // Since we are const, we need a non-const copy or cast. 
-            // Better: use the full make_move logic on a temporary copy or refactor.
-            // Given performance is less critical for 'is_legal' (used in UI/root), copy is fine.
-            Position tmp = *this; 
-            tmp.make_move(m, st);
-            return !tmp.is_attacked(Bitboards::lsb(tmp.pieces(side, KING)), static_cast<Color>(side ^ 1));
-        }
+    Square eksq = king_square(them);
+    if (eksq == SQ_NONE) return false;
+
+    // Direct check
+    if (state->check_squares[type_of(board[from])] & Bitboards::square_bb(to)) return true;
+
+    // Discovered check: a blocker leaves the line to the king
+    if ((discovered_check_candidates() & Bitboards::square_bb(from))
+        && (m.type() == CASTLING || !Bitboards::aligned(from, to, eksq)))
         return true;
-    } else {
-        // En Passant is tricky (removes two pieces, adds one)
-        // Standard moves: remove from, add to.
-        // Pin checks.
-        
-        // For S+++ robustness, let's just do the make_move check.
-        // It's safer and cleaner than custom pin logic if we want "crash proof".
-        Position tmp = *this;
-        StateInfo st;
-        tmp.make_move(m, st);
-        
-        Square k = Bitboards::lsb(tmp.pieces(side, KING));
-        return !tmp.is_attacked(k, static_cast<Color>(side ^ 1));
+
+    switch (m.type()) {
+    case NORMAL:
+        return false;
+
+    case PROMOTION: {
+        Bitboard occupied = all_pieces() ^ Bitboards::square_bb(from);
+        Bitboard attacks = m.promotion_piece() == KNIGHT ? Bitboards::knight_attacks(to)
+                         : m.promotion_piece() == BISHOP ? Bitboards::bishop_attacks(to, occupied)
+                         : m.promotion_piece() == ROOK   ? Bitboards::rook_attacks(to, occupied)
+                         :                                 Bitboards::queen_attacks(to, occupied);
+        return attacks & Bitboards::square_bb(eksq);
+    }
+
+    // The captured pawn can also uncover a slider
+    case EN_PASSANT: {
+        Square cap = static_cast<Square>(us == WHITE ? to + SOUTH : to + NORTH);
+        Bitboard occupied = (all_pieces() ^ Bitboards::square_bb(from) ^ Bitboards::square_bb(cap))
+                          | Bitboards::square_bb(to);
+        return (Bitboards::rook_attacks(eksq, occupied) & (pieces(us, ROOK) | pieces(us, QUEEN)))
+             | (Bitboards::bishop_attacks(eksq, occupied) & (pieces(us, BISHOP) | pieces(us, QUEEN)));
+    }
+
+    // Only the rook can give check
+    case CASTLING: {
+        bool king_side = to > from;
+        Square r_from = static_cast<Square>(king_side ? from + 3 : from - 4);
+        Square r_to = static_cast<Square>(king_side ? from + 1 : from - 1);
+        Bitboard occupied = (all_pieces() ^ Bitboards::square_bb(from) ^ Bitboards::square_bb(r_from))
+                          | Bitboards::square_bb(to) | Bitboards::square_bb(r_to);
+        return Bitboards::rook_attacks(r_to, occupied) & Bitboards::square_bb(eksq);
+    }
+    }
+    return false;
+}
+
+const int SeeValue[PIECE_TYPE_NB] = { 100, 325, 325, 500, 975, 0 };
+
+bool Position::see_ge(Move m, int threshold) const {
+    // Castling, en passant and promotions are treated as neutral exchanges
+    if (m.type() != NORMAL) return 0 >= threshold;
+
+    Square from = m.from(), to = m.to();
+
+    int swap = (board[to] == NO_PIECE ? 0 : SeeValue[type_of(board[to])]) - threshold;
+    if (swap < 0) return false;
+
+    swap = SeeValue[type_of(board[from])] - swap;
+    if (swap <= 0) return true;
+
+    Bitboard occupied = all_pieces() ^ Bitboards::square_bb(from) ^ Bitboards::square_bb(to);
+    Bitboard attackers = attackers_to(to, occupied);
+    Bitboard diagonal = type_bb[BISHOP] | type_bb[QUEEN];
+    Bitboard straight = type_bb[ROOK] | type_bb[QUEEN];
+    Color stm = side;
+    int res = 1;
+
+    // Swap list walked as a threshold test: each side recaptures with its
+    // least valuable attacker; removing it can reveal a slider behind it.
+    while (true) {
+        stm = static_cast<Color>(stm ^ 1);
+        attackers &= occupied;
+
+        Bitboard stm_attackers = attackers & pieces(stm);
+        if (!stm_attackers) break;
+
+        res ^= 1;
+
+        Bitboard bb;
+        if ((bb = stm_attackers & type_bb[PAWN])) {
+            if ((swap = SeeValue[PAWN] - swap) < res) break;
+            occupied ^= Bitboards::square_bb(Bitboards::lsb(bb));
+            attackers |= Bitboards::bishop_attacks(to, occupied) & diagonal;
+        } else if ((bb = stm_attackers & type_bb[KNIGHT])) {
+            if ((swap = SeeValue[KNIGHT] - swap) < res) break;
+            occupied ^= Bitboards::square_bb(Bitboards::lsb(bb));
+        } else if ((bb = stm_attackers & type_bb[BISHOP])) {
+            if ((swap = SeeValue[BISHOP] - swap) < res) break;
+            occupied ^= Bitboards::square_bb(Bitboards::lsb(bb));
+            attackers |= Bitboards::bishop_attacks(to, occupied) & diagonal;
+        } else if ((bb = stm_attackers & type_bb[ROOK])) {
+            if ((swap = SeeValue[ROOK] - swap) < res) break;
+            occupied ^= Bitboards::square_bb(Bitboards::lsb(bb));
+            attackers |= Bitboards::rook_attacks(to, occupied) & straight;
+        } else if ((bb = stm_attackers & type_bb[QUEEN])) {
+            if ((swap = SeeValue[QUEEN] - swap) < res) break;
+            occupied ^= Bitboards::square_bb(Bitboards::lsb(bb));
+            attackers |= (Bitboards::bishop_attacks(to, occupied) & diagonal)
+                       | (Bitboards::rook_attacks(to, occupied) & straight);
+        } else {
+            // King: may only recapture if the opponent has no attackers left
+            return (attackers & ~pieces(stm)) ? res ^ 1 : res;
+        }
     }
+
+    return res;
 }
 
 const int CastlePerm[64] = {
@@ -257,6 +450,12 @@ const int CastlePerm[64] = {
     7,  15, 15, 15, 3,  15, 15, 11  // Rank 8
 };
 
+void Position::copy_from(const Position& other, StateInfo& root) {
+    *this = other;
+    root = *other.state;
+    state = &root;
+}
+
 void Position::make_move(Move m, StateInfo& next_state) {
     Square from = m.from();
     Square to = m.to();
@@ -323,6 +522,7 @@ void Position::make_move(Move m, StateInfo& next_state) {
     state->key ^= Zobrist::castle_keys[state->castle_rights];
     
     side = static_cast<Color>(side ^ 1);
+    set_check_info();
     
     if (history_index < 1024) {
         hash_history[history_index++] = state->key;
@@ -337,36 +537,30 @@ void Position::unmake_move(Move m) {
     Square to = m.to();
     MoveType type = m.type();
     
-    Piece p_moved = board[to]; 
-    
+    // Only the board is put back; keys, scores and phase are those of the
+    // previous StateInfo
     if (type == PROMOTION) {
-        remove_piece(to);
-        p_moved = make_piece(side, PAWN); 
+        clear_square(to);
+        set_square(make_piece(side, PAWN), from);
     } else if (type == CASTLING) {
-        remove_piece(to);
+        move_piece(to, from);
         Square r_from, r_to;
         if (to == SQ_G1) { r_from = SQ_H1; r_to = SQ_F1; }
         else if (to == SQ_C1) { r_from = SQ_A1; r_to = SQ_D1; }
         else if (to == SQ_G8) { r_from = SQ_H8; r_to = SQ_F8; }
         else { r_from = SQ_A8; r_to = SQ_D8; }
-        Piece rook = board[r_to];
-        remove_piece(r_to);
-        put_piece(rook, r_from);
-        
-        p_moved = make_piece(side, KING); 
+        move_piece(r_to, r_from);
     } else {
-        remove_piece(to);
+        move_piece(to, from);
     }
     
-    put_piece(p_moved, from);
-    
     Piece captured = state->captured_piece;
     if (captured != NO_PIECE) {
         if (type == EN_PASSANT) {
             Square ep_victim = (side == WHITE) ? static_cast<Square>(to + SOUTH) : static_cast<Square>(to + NORTH);
-            put_piece(captured, ep_victim);
+            set_square(captured, ep_victim);
         } else {
-            put_piece(captured, to);
+            set_square(captured, to);
         }
     }
     
@@ -387,6 +581,8 @@ void Position::make_null_move(StateInfo& next_state) {
     state->halfmove_clock++;
     
     side = static_cast<Color>(side ^ 1);
+    // Check squares depend on the side to move, so recompute everything
+    set_check_info();
     if (history_index < 1024) {
         hash_history[history_index++] = state->key;
     }
@@ -451,6 +647,7 @@ void Position::set_fen(const std::string& fen) {
     }
     
     state->halfmove_clock = halfmove;
+    set_check_info();
     
     history_index = 0;
     hash_history[history_index++] = state->key;
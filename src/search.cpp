@@ -7,15 +7,19 @@
 #include "opt/mthread.h"
 #include "syzygy/tbprobe.h"
 #include "mcache.h"
+#include "ucioption.h"
+#include "timeman.h"
 #include <algorithm>
 #include <iostream>
-#include <chrono>
 #include <cmath>
 #include <vector>
 #include <atomic>
 #include <cstring>
 #include <array>
 #include <iomanip>
+#include <sstream>
+#include <mutex>
+#include <condition_variable>
 
 namespace Search {
 
@@ -24,224 +28,666 @@ namespace Search {
 constexpr int MAX_PLY = 128;
 constexpr int INFINITE_SCORE = 32000;
 constexpr int MATE_SCORE = 31000;
-constexpr int MATE_BOUND = 30000;
+constexpr int VALUE_NONE = 32002; // No static eval (side to move in check)
+// Quiescence depths: the first ply also tries quiet checks, deeper plies
+// only captures. Both are below any main search depth in the TT.
+constexpr int DEPTH_QS_CHECKS = 0;
+constexpr int DEPTH_QS_NO_CHECKS = -1;
 
 std::atomic<bool> stop_search{false};
 std::atomic<long long> nodes_searched{0};
-std::chrono::time_point<std::chrono::steady_clock> start_time;
-long long time_hard_limit = 0;
-long long time_soft_limit = 0;
-bool run_infinite = false;
+std::atomic<bool> pondering{false};
+std::atomic<bool> stop_on_ponderhit{false}; // Soft limit passed while pondering
+
+// A finished main thread sleeps here until stop or ponderhit
+std::mutex wait_mutex;
+std::condition_variable wait_cv;
+long long node_limit = 0; // "go nodes", 0 = none
+int multi_pv = 1; // Root lines searched per iteration, capped by the root move count
 
 // --- Tuning Cache ---
+constexpr int LMP_MAX_DEPTH = 8;
+constexpr int SINGULAR_MIN_DEPTH = 8;
+constexpr int PROBCUT_MIN_DEPTH = 5;
+constexpr int IIR_MIN_DEPTH = 4;
+
 struct SearchParams {
-    int LMR_Base;
-    int LMR_Factor;
     int RFP_Margin;
     int NMP_Depth;
+    int Futility_Margin;
+    int History_Prune;
+    int SEE_Quiet_Margin;
+    int SEE_Capture_Margin;
+    int ProbCut_Margin;
+    int LMPCount[2][LMP_MAX_DEPTH + 1]; // [improving][depth]
 } SP;
 
 void refresh_params() {
-    SP.LMR_Base = Tune::get("LMR_Base");
-    SP.LMR_Factor = Tune::get("LMR_Factor");
     SP.RFP_Margin = Tune::get("RFP_Margin");
     // SP.NMP_Depth = Tune::get("NMP_Depth"); // Example
+    SP.Futility_Margin = Tune::get("Futility_Margin");
+    SP.History_Prune = Tune::get("History_Prune");
+    SP.SEE_Quiet_Margin = Tune::get("SEE_Quiet_Margin");
+    SP.SEE_Capture_Margin = Tune::get("SEE_Capture_Margin");
+    SP.ProbCut_Margin = Tune::get("ProbCut_Margin");
+
+    int lmp_base = Tune::get("LMP_Base");
+    for (int d = 0; d <= LMP_MAX_DEPTH; ++d) {
+        SP.LMPCount[0][d] = (lmp_base + d * d) / 2;
+        SP.LMPCount[1][d] = lmp_base + d * d;
+    }
+}
+
+// --- Late Move Reductions ---
+// Base reduction in 1/1024 plies, [depth][move count]. Rebuilt when
+// LMR_Base or LMR_Factor change instead of taking logs per move.
+constexpr int LMR_SIZE = 64;
+int Reductions[LMR_SIZE][LMR_SIZE];
+
+void init_reductions() {
+    double base = Tune::get("LMR_Base") / 100.0;
+    double factor = std::max(1, Tune::get("LMR_Factor")) / 100.0;
+    for (int d = 0; d < LMR_SIZE; ++d)
+        for (int m = 0; m < LMR_SIZE; ++m)
+            Reductions[d][m] = (d && m) ? static_cast<int>(1024 * (base + std::log(d) * std::log(m) / factor)) : 0;
+}
+
+int reduction(int depth, int move_count) {
+    return Reductions[std::min(depth, LMR_SIZE - 1)][std::min(move_count, LMR_SIZE - 1)];
 }
 
 // --- Heuristics ---
-// Shared History (Lazy SMP)
-std::atomic<int> History[COLOR_NB][SQ_NB][SQ_NB]; 
-Move Killers[MAX_PLY][2];
+// History scores saturate at +-HISTORY_MAX: each update moves an entry
+// towards the bound by a fraction of the remaining distance ("gravity"),
+// so frequently hit moves cannot overflow and stale ones fade.
+constexpr int HISTORY_MAX = 16384;
 
-// --- Static Exchange Evaluation (SEE) ---
+int stat_bonus(int depth) {
+    return std::min(32 * depth * depth, 1600);
+}
 
-const int PieceValue[PIECE_TYPE_NB] = { 0, 100, 325, 325, 500, 975, 0 };
+template<typename T>
+void update_history(T& entry, int bonus) {
+    entry += bonus - entry * std::abs(bonus) / HISTORY_MAX;
+}
 
-int see(const Position& pos, Move m) {
-    if (m.type() == CASTLING || m.type() == EN_PASSANT) return 0; // Simplified
-    
-    Square to = m.to();
-    Square from = m.from();
-    
-    int gain[32];
-    int d = 0;
-    
-    Piece captured = pos.piece_on(to);
-    gain[d] = (captured == NO_PIECE ? 0 : PieceValue[type_of(captured)]);
-    
-    // Initial piece
-    PieceType attacker_pt = type_of(pos.piece_on(from));
-    
-    // If promotion
-    if (m.type() == PROMOTION) {
-        gain[d] += PieceValue[m.promotion_piece()] - PieceValue[PAWN];
-        attacker_pt = m.promotion_piece();
+// Continuation history: scores of [piece][to] given the piece and target
+// of an earlier move on the line. Row PIECE_NB is a never-updated zero row
+// used after a null move or at the root.
+typedef int16_t PieceToHistory[PIECE_NB][SQ_NB];
+typedef PieceToHistory ContinuationHistory[PIECE_NB + 1][SQ_NB];
+
+// Capture history: [moved piece][to][captured type]
+typedef int16_t CaptureHistory[PIECE_NB][SQ_NB][PIECE_TYPE_NB];
+
+// Per-ply record of the line being searched, indexed by ply + 2 so that
+// (ss - 1) and (ss - 2) exist at the root.
+struct Stack {
+    int ply;
+    int static_eval;
+    Move current_move;
+    Move excluded_move;
+    Piece moved_piece;
+    PieceToHistory* cont_hist;
+};
+
+// MVV/LVA and pruning margins (SEE itself lives in Position::see_ge)
+const int PieceValue[PIECE_TYPE_NB] = { 100, 325, 325, 500, 975, 0 };
+
+// --- Root Moves ---
+// Legal moves at the root with the result of their latest search. Sorted
+// after every completed root search, so front() is the best move and its
+// pv is the principal variation.
+
+struct RootMove {
+    Move move;
+    int score = -INFINITE_SCORE;
+    int previous_score = -INFINITE_SCORE;
+    long long nodes = 0;
+    std::vector<Move> pv;
+
+    explicit RootMove(Move m) : move(m), pv(1, m) {}
+    bool operator==(Move m) const { return move == m; }
+    bool operator<(const RootMove& o) const {
+        return score != o.score ? score > o.score : previous_score > o.previous_score;
     }
-    
-    // Hidden variable: occupancy
-    // Ideally requires bitboard manipulation: xray attacks.
-    // For this level, we can use a "swap list" approximation or full SEE.
-    // Implementing full SEE requires "least valuable attacker" extraction.
-    
-    // Simplified SEE:
-    return gain[0]; // Placeholder for safety if we don't have full `attackers_to`
-}
+};
 
 // --- Thread Data ---
+// One per worker, kept across searches so heuristics carry over from move
+// to move. Only ucinewgame (Search::clear) wipes them. Move ordering tables
+// are private to the thread and start on their own cache lines, so the
+// move loop never writes memory another thread reads.
 
-struct ThreadData {
+struct alignas(64) ThreadData {
     int id;
-    long long nodes = 0;
-    Move killers[MAX_PLY][2];
-    int history[COLOR_NB][SQ_NB][SQ_NB]; // Local copy or pointer? using shared for now.
+    // Only the owning thread writes it, so a relaxed load and store count a
+    // node without a locked add; other threads sum it for reports and limits.
+    // It has a cache line to itself so those reads never pull in the lines
+    // the search writes.
+    alignas(64) std::atomic<long long> nodes{0};
+
+    // Private copy of the root; helpers never touch the caller's Position
+    alignas(64) Position root_pos;
+    StateInfo root_state;
+
+    // Result of the last fully completed iteration, read by other threads
+    std::atomic<int> completed_depth{0};
+    std::atomic<int> best_score{0};
+    Move best_move;
+
+    std::vector<RootMove> root_moves;
+    int pv_idx = 0; // MultiPV slot being searched; root moves before it are done
+    int sel_depth = 0; // Deepest ply reached this iteration, counted from 1
+
+    // Triangular PV: pv_table[ply] holds the line from ply onwards, of
+    // which pv_length[ply] - ply moves are valid
+    Move pv_table[MAX_PLY + 1][MAX_PLY + 1];
+    int pv_length[MAX_PLY + 1];
+
+    alignas(64) Move killers[MAX_PLY][2];
+    alignas(64) int history[COLOR_NB][SQ_NB][SQ_NB];
+    alignas(64) Move counter_moves[PIECE_NB][SQ_NB];
+    alignas(64) ContinuationHistory cont_history;
+    alignas(64) CaptureHistory capture_history;
+    Stack stack[MAX_PLY + 4];
     
     ThreadData(int i) : id(i) {
+        clear();
+    }
+
+    void clear() {
+        std::memset(killers, 0, sizeof(killers));
+        std::memset(history, 0, sizeof(history));
+        std::memset(counter_moves, 0, sizeof(counter_moves));
+        std::memset(cont_history, 0, sizeof(cont_history));
+        std::memset(capture_history, 0, sizeof(capture_history));
+    }
+
+    Stack* ss(int ply) { return &stack[ply + 2]; }
+
+    void count_node() { nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+    PieceToHistory* no_cont_hist() { return &cont_history[PIECE_NB][0]; }
+
+    // Between searches: killers belong to plies of the previous root and
+    // are dropped, history keeps half its weight.
+    void age() {
         std::memset(killers, 0, sizeof(killers));
+        for(auto& side : history)
+            for(auto& from : side)
+                for(int& h : from) h /= 2;
     }
 };
 
 Opt::ThreadPool thread_pool;
+std::vector<std::unique_ptr<ThreadData>> thread_data;
+
+// Workers and their data are only rebuilt when the thread count changes
+void init_threads(int num_threads) {
+    thread_pool.init(num_threads);
+    while (static_cast<int>(thread_data.size()) > num_threads) thread_data.pop_back();
+    while (static_cast<int>(thread_data.size()) < num_threads)
+        thread_data.push_back(std::make_unique<ThreadData>(static_cast<int>(thread_data.size())));
+}
 
 // --- Move Picker ---
+// Staged: each stage is generated only when the previous one is exhausted,
+// so a cut on the hash move or the first capture never pays for quiet
+// generation. Moves are picked by partial selection sort.
+
+enum PickStage {
+    MAIN_TT, CAPTURE_INIT, GOOD_CAPTURE, KILLER_1, KILLER_2, COUNTER_MOVE, QUIET_INIT, QUIET, BAD_CAPTURE,
+    EVASION_TT, EVASION_INIT, EVASION,
+    QS_TT, QS_CAPTURE_INIT, QS_CAPTURE, QS_CHECK_INIT, QS_CHECK,
+    PROBCUT_TT, PROBCUT_INIT, PROBCUT,
+    STAGE_END
+};
 
 struct MovePicker {
     const Position& pos;
+    const ThreadData* td = nullptr;
     Move hash_move;
-    int depth;
+    Move killers[2];
+    Move counter_move;
+    const PieceToHistory* cont_hist[2] = {};
     MoveGen::MoveList moves;
     int scores[256];
     int cur = 0;
-    int phase = 0;
-    
-    MovePicker(const Position& p, Move hm, int d) : pos(p), hash_move(hm), depth(d) {}
-    
-    int score(Move m) {
-        if (m == hash_move) return 2000000;
-        if (m.type() == PROMOTION && m.promotion_piece() == QUEEN) return 1000000;
-        
-        if (pos.is_capture(m)) {
-            // MVV/LVA
-            Piece attacker = pos.piece_on(m.from());
-            Piece victim = pos.piece_on(m.to());
-            return 100000 + PieceValue[type_of(victim)] * 10 - PieceValue[type_of(attacker)];
+    int end_bad = 0;   // Bad captures are parked in [0, end_bad)
+    int end_captures = 0;
+    int stage;
+    bool skip_quiets = false; // Set by late move pruning
+    bool with_checks = false; // Quiescence: follow captures with quiet checks
+    int see_threshold = 0;    // ProbCut: captures must win at least this much
+
+    // Main search
+    MovePicker(const Position& p, Move hm, int ply, const ThreadData& t, const Stack* ss) : pos(p), td(&t), hash_move(hm) {
+        killers[0] = td->killers[ply][0];
+        killers[1] = td->killers[ply][1];
+        Move prev = (ss - 1)->current_move;
+        counter_move = prev != Move::none() ? td->counter_moves[(ss - 1)->moved_piece][prev.to()] : Move::none();
+        if (counter_move == killers[0] || counter_move == killers[1]) counter_move = Move::none();
+        cont_hist[0] = (ss - 1)->cont_hist;
+        cont_hist[1] = (ss - 2)->cont_hist;
+        bool tt_ok = hash_move != Move::none() && pos.is_pseudo_legal(hash_move);
+        if (pos.checkers()) stage = tt_ok ? EVASION_TT : EVASION_INIT;
+        else stage = tt_ok ? MAIN_TT : CAPTURE_INIT;
+    }
+
+    // Quiescence: evasions when in check, otherwise captures and, at the
+    // first quiescence ply, quiet checks
+    MovePicker(const Position& p, Move hm, const ThreadData& t, int depth) : pos(p), td(&t), hash_move(hm) {
+        killers[0] = killers[1] = counter_move = Move::none();
+        cont_hist[0] = cont_hist[1] = &td->cont_history[PIECE_NB][0];
+        with_checks = depth >= DEPTH_QS_CHECKS;
+        if (pos.checkers()) {
+            stage = (hash_move != Move::none() && pos.is_pseudo_legal(hash_move)) ? EVASION_TT : EVASION_INIT;
+        } else {
+            stage = (hash_move != Move::none() && pos.is_capture(hash_move) && pos.is_pseudo_legal(hash_move))
+                  ? QS_TT : QS_CAPTURE_INIT;
         }
-        
-        // Killers
-        if (m == Killers[depth][0]) return 90000;
-        if (m == Killers[depth][1]) return 80000;
-        
-        // History
-        return History[pos.side_to_move()][m.from()][m.to()].load(std::memory_order_relaxed);
     }
-    
+
+    // ProbCut: captures (hash move included) whose SEE reaches the threshold
+    MovePicker(const Position& p, Move hm, int threshold, const ThreadData& t)
+        : pos(p), td(&t), hash_move(hm), see_threshold(threshold) {
+        killers[0] = killers[1] = counter_move = Move::none();
+        cont_hist[0] = cont_hist[1] = &td->cont_history[PIECE_NB][0];
+        stage = (hash_move != Move::none() && pos.is_capture(hash_move) && pos.is_pseudo_legal(hash_move)
+                 && pos.see_ge(hash_move, see_threshold)) ? PROBCUT_TT : PROBCUT_INIT;
+    }
+
+    void score_captures() {
+        for(int i=cur; i<moves.count; ++i) {
+            // MVV/LVA, refined by how this capture has fared before
+            Piece attacker = pos.piece_on(moves[i].from());
+            Piece victim = pos.piece_on(moves[i].to());
+            PieceType captured = (victim == NO_PIECE) ? PAWN : type_of(victim);
+            scores[i] = PieceValue[captured] * 10 - PieceValue[type_of(attacker)]
+                      + td->capture_history[attacker][moves[i].to()][captured] / 8;
+            if (moves[i].type() == PROMOTION) scores[i] += PieceValue[moves[i].promotion_piece()];
+        }
+    }
+
+    int quiet_score(Color us, Move m) const {
+        Piece pc = pos.piece_on(m.from());
+        return td->history[us][m.from()][m.to()]
+             + (*cont_hist[0])[pc][m.to()]
+             + (*cont_hist[1])[pc][m.to()];
+    }
+
+    void score_quiets() {
+        Color us = pos.side_to_move();
+        for(int i=cur; i<moves.count; ++i) {
+            Move m = moves[i];
+            if (m.type() == PROMOTION && m.promotion_piece() == QUEEN) scores[i] = 1000000;
+            else scores[i] = quiet_score(us, m);
+        }
+    }
+
+    // Captures first (MVV/LVA), then quiets by history
+    void score_evasions() {
+        Color us = pos.side_to_move();
+        for(int i=cur; i<moves.count; ++i) {
+            Move m = moves[i];
+            if (pos.is_capture(m)) {
+                Piece victim = pos.piece_on(m.to());
+                int v = (victim == NO_PIECE) ? PieceValue[PAWN] : PieceValue[type_of(victim)];
+                scores[i] = 10000000 + v * 10 - PieceValue[type_of(pos.piece_on(m.from()))];
+            } else {
+                scores[i] = quiet_score(us, m);
+            }
+        }
+    }
+
+    // Selection step: swap the best remaining move into 'cur'
+    Move pick_best(int end) {
+        int best = cur;
+        for(int i=cur+1; i<end; ++i) if (scores[i] > scores[best]) best = i;
+        std::swap(moves[cur], moves[best]);
+        std::swap(scores[cur], scores[best]);
+        return moves[cur++];
+    }
+
+    bool is_killer(Move m) const { return m == killers[0] || m == killers[1] || m == counter_move; }
+
     bool next(Move& m) {
-        // 1. Hash
-        if (phase == 0) {
-            phase = 1;
-            if (hash_move != Move::none() && pos.is_pseudo_legal(hash_move)) {
-                m = hash_move;
+        if (skip_quiets && stage >= KILLER_1 && stage <= QUIET) {
+            cur = 0;
+            stage = BAD_CAPTURE;
+        }
+
+        switch (stage) {
+        case MAIN_TT:
+        case EVASION_TT:
+        case QS_TT:
+        case PROBCUT_TT:
+            ++stage;
+            m = hash_move;
+            return true;
+
+        case CAPTURE_INIT:
+        case QS_CAPTURE_INIT:
+        case PROBCUT_INIT:
+            cur = end_bad = 0;
+            MoveGen::generate<MoveGen::CAPTURES>(pos, moves);
+            end_captures = moves.count;
+            score_captures();
+            ++stage;
+            return next(m);
+
+        case GOOD_CAPTURE:
+            while (cur < end_captures) {
+                m = pick_best(end_captures);
+                if (m == hash_move) continue;
+                if (pos.see_ge(m, 0)) return true;
+                // Losing capture: defer until after the quiets
+                moves[end_bad++] = m;
+            }
+            ++stage;
+            return next(m);
+
+        case KILLER_1:
+        case KILLER_2: {
+            Move k = killers[stage - KILLER_1];
+            ++stage;
+            if (k != Move::none() && k != hash_move && !pos.is_capture(k) && pos.is_pseudo_legal(k)) {
+                m = k;
                 return true;
             }
+            return next(m);
         }
-        
-        // 2. Generate All (Simplification for readability/compactness)
-        if (phase == 1) {
-            phase = 2;
-            MoveGen::generate<MoveGen::ALL>(pos, moves);
-            for(int i=0; i<moves.count; ++i) {
-                if(moves[i] == hash_move) { scores[i] = -1; continue; }
-                scores[i] = score(moves[i]);
+
+        case COUNTER_MOVE:
+            ++stage;
+            if (counter_move != Move::none() && counter_move != hash_move && !pos.is_capture(counter_move)
+                && pos.is_pseudo_legal(counter_move)) {
+                m = counter_move;
+                return true;
             }
-        }
-        
-        // 3. Selection
-        if (phase == 2) {
-            int best = -1;
-            int max_val = -10000000;
-            for(int i=0; i<moves.count; ++i) {
-                if (scores[i] > max_val) {
-                    max_val = scores[i];
-                    best = i;
-                }
+            return next(m);
+
+        case QUIET_INIT:
+            cur = end_captures;
+            MoveGen::generate<MoveGen::QUIETS>(pos, moves);
+            score_quiets();
+            ++stage;
+            return next(m);
+
+        case QUIET:
+            while (cur < moves.count) {
+                m = pick_best(moves.count);
+                if (m != hash_move && !is_killer(m)) return true;
             }
-            
-            if (best != -1) {
-                m = moves[best];
-                scores[best] = -10000000; // consumed
-                return true;
+            cur = 0;
+            ++stage;
+            return next(m);
+
+        case BAD_CAPTURE:
+            while (cur < end_bad) {
+                m = moves[cur++];
+                if (m != hash_move) return true;
+            }
+            stage = STAGE_END;
+            return false;
+
+        case EVASION_INIT:
+            cur = 0;
+            MoveGen::generate<MoveGen::EVASIONS>(pos, moves);
+            score_evasions();
+            ++stage;
+            return next(m);
+
+        case EVASION:
+            while (cur < moves.count) {
+                m = pick_best(moves.count);
+                if (m != hash_move) return true;
             }
+            stage = STAGE_END;
+            return false;
+
+        case QS_CAPTURE:
+            while (cur < end_captures) {
+                m = pick_best(end_captures);
+                if (m != hash_move) return true;
+            }
+            if (!with_checks) {
+                stage = STAGE_END;
+                return false;
+            }
+            ++stage;
+            return next(m);
+
+        case QS_CHECK_INIT:
+            cur = moves.count = 0;
+            MoveGen::generate<MoveGen::QUIET_CHECKS>(pos, moves);
+            ++stage;
+            return next(m);
+
+        case QS_CHECK:
+            while (cur < moves.count) {
+                m = moves[cur++];
+                if (m != hash_move) return true;
+            }
+            stage = STAGE_END;
+            return false;
+
+        case PROBCUT:
+            while (cur < end_captures) {
+                m = pick_best(end_captures);
+                if (m != hash_move && pos.see_ge(m, see_threshold)) return true;
+            }
+            stage = STAGE_END;
+            return false;
+
+        default:
+            return false;
         }
-        
-        return false;
     }
 };
 
-// --- Time Check ---
+// --- Limits ---
 
+long long total_nodes() {
+    long long n = 0;
+    for(auto& t : thread_data) n += t->nodes.load(std::memory_order_relaxed);
+    return n;
+}
+
+// Search time as the time manager sees it: under nodestime the virtual
+// clock, so reported time and nps agree with the budget being spent
+long long elapsed_ms(long long nodes) {
+    return std::max<long long>(1, ClercX::Time.elapsed(nodes));
+}
+
+// Hard limit only; the soft limit is judged between iterations
 void check_time() {
-    if (run_infinite || stop_search) return;
-    auto now = std::chrono::steady_clock::now();
-    long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
-    
-    if (elapsed > time_hard_limit) stop_search = true;
+    if (!ClercX::Time.use_time() || stop_search || pondering) return;
+    if (ClercX::Time.elapsed(total_nodes()) > ClercX::Time.maximum_time()) stop_search = true;
+}
+
+// Polled before each node is counted; only the main thread acts on it, so
+// helpers never read the other threads' counters. Alone it checks a node
+// budget at every node from its own counter, which stops the search exactly
+// on the limit. With helpers it sums every 1024 nodes, so the search may
+// run up to that many nodes per thread past the budget. The clock is read
+// every 2048 nodes.
+void check_limits(const ThreadData& td) {
+    if (td.id != 0) return;
+    long long n = td.nodes.load(std::memory_order_relaxed);
+    if (node_limit) {
+        if (thread_data.size() == 1 ? n >= node_limit
+                                    : (n & 1023) == 0 && total_nodes() >= node_limit)
+            stop_search = true;
+    }
+    if ((n & 2047) == 0) check_time();
+}
+
+// --- PV ---
+
+// Move m at ply becomes the head of the line, followed by the child's PV
+void update_pv(ThreadData& td, int ply, Move m) {
+    td.pv_table[ply][ply] = m;
+    int len = td.pv_length[ply + 1];
+    for (int i = ply + 1; i < len; ++i) td.pv_table[ply][i] = td.pv_table[ply + 1][i];
+    td.pv_length[ply] = std::max(len, ply + 1);
 }
 
 // --- QSearch ---
 
-int qsearch(Position& pos, int alpha, int beta, int ply, ThreadData& td) {
-    if ((td.nodes & 2047) == 0 && td.id == 0) check_time();
+int qsearch(Position& pos, int alpha, int beta, int ply, ThreadData& td, int depth = DEPTH_QS_CHECKS) {
+    td.pv_length[ply] = ply;
+    check_limits(td);
     if (stop_search) return 0;
     
-    td.nodes++;
-    
-    int stand_pat = Eval::evaluate(pos);
-    if (ply >= MAX_PLY) return stand_pat;
-    
-    if (stand_pat >= beta) return beta;
-    if (alpha < stand_pat) alpha = stand_pat;
-    
-    MoveGen::MoveList moves;
-    MoveGen::generate<MoveGen::CAPTURES>(pos, moves);
+    td.count_node();
+    if (ply >= td.sel_depth) td.sel_depth = ply + 1;
     
-    // Sort
-    int scores[256];
-    for(int i=0; i<moves.count; ++i) {
-        // MVV/LVA
-        Piece v = pos.piece_on(moves[i].to());
-        Piece a = pos.piece_on(moves[i].from());
-        scores[i] = (v == NO_PIECE ? 0 : PieceValue[type_of(v)]) * 10 - PieceValue[type_of(a)];
+    if (pos.is_draw()) return 0;
+    if (ply >= MAX_PLY) return pos.checkers() ? 0 : Eval::evaluate(pos);
+
+    bool pv_node = beta - alpha > 1;
+    bool in_check = pos.checkers();
+
+    // Entries searched with quiet checks are good enough for nodes without
+    int tt_depth = (in_check || depth >= DEPTH_QS_CHECKS) ? DEPTH_QS_CHECKS : DEPTH_QS_NO_CHECKS;
+
+    TTEntry tte;
+    bool tt_hit = TT.probe(pos.hash(), tte);
+    Move tt_move = tt_hit ? tte.move : Move::none();
+    if (tt_hit && !pv_node && tte.depth() >= tt_depth) {
+        int s = value_from_tt(tte.score, ply);
+
+        if (tte.flag() == EXACT) return s;
+        if (tte.flag() == ALPHA && s <= alpha) return alpha;
+        if (tte.flag() == BETA && s >= beta) return beta;
     }
-    
-    for(int i=0; i<moves.count; ++i) {
-        int best = i;
-        for(int j=i+1; j<moves.count; ++j) if(scores[j] > scores[best]) best = j;
-        std::swap(moves[i], moves[best]); std::swap(scores[i], scores[best]);
-        
-        Move m = moves[i];
-        if (!pos.is_legal(m)) continue; // Expensive?
-        
-        // Delta Pruning
-        // if (stand_pat + PieceValue[type_of(pos.piece_on(m.to()))] + 200 < alpha) continue;
+
+    // Stand pat, with the static eval reused from the TT when available and
+    // kept in the stack as search() does. In check there is no stand pat:
+    // every evasion is searched.
+    Stack* ss = td.ss(ply);
+    ss->static_eval = VALUE_NONE;
+    int futility_base = -INFINITE_SCORE;
+    if (!in_check) {
+        ss->static_eval = (tt_hit && tte.eval != VALUE_NONE) ? tte.eval : Eval::evaluate(pos);
+        int stand_pat = ss->static_eval;
+        if (tt_hit && std::abs(tte.score) < MATE_BOUND - MAX_PLY
+            && (tte.flag() == EXACT || tte.flag() == (tte.score > ss->static_eval ? BETA : ALPHA)))
+            stand_pat = tte.score;
+
+        if (stand_pat >= beta) {
+            if (!tt_hit) TT.store(pos.hash(), Move::none(), stand_pat, ss->static_eval, tt_depth, BETA, ply);
+            return beta;
+        }
+        if (alpha < stand_pat) alpha = stand_pat;
+        futility_base = stand_pat + 200;
+    }
+
+    Move best_move = Move::none();
+    TTFlag flag = ALPHA;
+    int moves_played = 0;
+
+    MovePicker mp(pos, tt_move, td, depth);
+    Move m;
+    while (mp.next(m)) {
+        if (!in_check) {
+            // Losing captures and checks cannot raise a stand-pat score
+            if (!pos.see_ge(m, 0)) continue;
+
+            // Futility (delta) pruning: even winning the victim outright
+            // plus a margin stays below alpha, and the exchange gains nothing more
+            if (pos.is_capture(m) && m.type() != PROMOTION) {
+                Piece victim = pos.piece_on(m.to());
+                int gain = (victim == NO_PIECE) ? PieceValue[PAWN] : PieceValue[type_of(victim)];
+                if (futility_base + gain <= alpha && !pos.see_ge(m, 1)) continue;
+            }
+        }
+
+        if (!pos.is_legal(m)) continue;
+        moves_played++;
 
         StateInfo st;
         pos.make_move(m, st);
-        int score = -qsearch(pos, -beta, -alpha, ply+1, td);
+        TT.prefetch(pos.hash());
+        int score = -qsearch(pos, -beta, -alpha, ply+1, td, depth-1);
         pos.unmake_move(m);
         
         if (stop_search) return 0;
-        
-        if (score >= beta) return beta;
-        if (score > alpha) alpha = score;
+
+        if (score >= beta) {
+            TT.store(pos.hash(), m, beta, ss->static_eval, tt_depth, BETA, ply);
+            return beta;
+        }
+        if (score > alpha) {
+            alpha = score;
+            best_move = m;
+            flag = EXACT;
+            if (pv_node) update_pv(td, ply, m);
+        }
     }
+
+    // Every evasion was searched, so none means mate
+    if (in_check && moves_played == 0) return -MATE_BOUND + ply;
+
+    TT.store(pos.hash(), best_move, alpha, ss->static_eval, tt_depth, flag, ply);
     return alpha;
 }
 
+// --- History Updates ---
+
+// Continuation histories of the one- and two-ply-old moves on the line.
+// A null move or the root leaves no move to continue from.
+void update_cont_histories(Stack* ss, Piece pc, Square to, int bonus) {
+    for (int i : {1, 2})
+        if ((ss - i)->current_move != Move::none())
+            update_history((*(ss - i)->cont_hist)[pc][to], bonus);
+}
+
+// On a beta cutoff: reward the cut move in the tables that ordered it and
+// penalise the moves of the same kind that were tried first and failed.
+void update_cutoff_stats(const Position& pos, ThreadData& td, Stack* ss, int ply, Move best, int depth,
+                         const Move* quiets, int quiet_count, const Move* captures, int capture_count) {
+    Color us = pos.side_to_move();
+    int bonus = stat_bonus(depth);
+
+    if (!pos.is_capture(best)) {
+        if (td.killers[ply][0] != best) {
+            td.killers[ply][1] = td.killers[ply][0];
+            td.killers[ply][0] = best;
+        }
+        Move prev = (ss - 1)->current_move;
+        if (prev != Move::none()) td.counter_moves[(ss - 1)->moved_piece][prev.to()] = best;
+
+        update_history(td.history[us][best.from()][best.to()], bonus);
+        update_cont_histories(ss, pos.piece_on(best.from()), best.to(), bonus);
+        for (int i = 0; i < quiet_count; ++i) {
+            update_history(td.history[us][quiets[i].from()][quiets[i].to()], -bonus);
+            update_cont_histories(ss, pos.piece_on(quiets[i].from()), quiets[i].to(), -bonus);
+        }
+    } else {
+        Piece victim = pos.piece_on(best.to());
+        PieceType captured = victim == NO_PIECE ? PAWN : type_of(victim);
+        update_history(td.capture_history[pos.piece_on(best.from())][best.to()][captured], bonus);
+    }
+
+    // Captures searched before the cut move did not refute
+    for (int i = 0; i < capture_count; ++i) {
+        Piece victim = pos.piece_on(captures[i].to());
+        PieceType captured = victim == NO_PIECE ? PAWN : type_of(victim);
+        update_history(td.capture_history[pos.piece_on(captures[i].from())][captures[i].to()][captured], -bonus);
+    }
+}
+
 // --- Search ---
 
 int search(Position& pos, int alpha, int beta, int depth, int ply, ThreadData& td, bool do_null) {
+    td.pv_length[ply] = ply;
     if (stop_search) return 0;
     
     bool root = (ply == 0);
+    bool pv_node = beta - alpha > 1;
     
     if (!root) {
         if (pos.is_draw()) return 0;
@@ -254,44 +700,75 @@ int search(Position& pos, int alpha, int beta, int depth, int ply, ThreadData& t
         if (alpha >= beta) return alpha;
     }
     
-    if (td.id == 0 && (td.nodes & 2047) == 0) check_time();
-    
-    td.nodes++;
+    check_limits(td);
+    if (stop_search) return 0;
+
+    td.count_node();
+    if (ply >= td.sel_depth) td.sel_depth = ply + 1;
     
     // QSearch at horizon
     if (depth <= 0) return qsearch(pos, alpha, beta, ply, td);
     
+    Stack* ss = td.ss(ply);
+    ss->ply = ply;
+    (ss + 1)->excluded_move = Move::none();
+
+    // Set while verifying that this move is singular: the node is searched
+    // without it, so TT results for the full node must not be used or stored
+    Move excluded = ss->excluded_move;
+
     bool in_check = pos.checkers();
     if (in_check) depth++; // Check Extension
 
     // TT
     TTEntry tte;
     Move hash_move = Move::none();
-    if (TT.probe(pos.hash(), tte)) {
+    bool tt_hit = TT.probe(pos.hash(), tte);
+    if (tt_hit) {
         hash_move = tte.move;
-        if (!root && tte.depth >= depth) {
-             int s = tte.score;
-             if (s > MATE_BOUND) s -= ply; else if (s < -MATE_BOUND) s += ply;
+        if (!pv_node && excluded == Move::none() && tte.depth() >= depth) {
+             int s = value_from_tt(tte.score, ply);
              
-             if (tte.flag == EXACT) return s;
-             if (tte.flag == ALPHA && s <= alpha) return alpha;
-             if (tte.flag == BETA && s >= beta) return beta;
+             if (tte.flag() == EXACT) return s;
+             if (tte.flag() == ALPHA && s <= alpha) return alpha;
+             if (tte.flag() == BETA && s >= beta) return beta;
         }
     }
     
     // Static Eval
-    int eval = 0;
-    if (!in_check) {
-        eval = Eval::evaluate(pos);
-        
+    // Taken from the TT entry when there is one, and sharpened by the TT
+    // score when its bound points the right way.
+    int eval = VALUE_NONE;
+    bool improving = false;
+    if (in_check) {
+        ss->static_eval = VALUE_NONE;
+    } else if (excluded != Move::none()) {
+        // Same position as the enclosing search: its eval is already set
+        eval = ss->static_eval;
+        improving = (ss - 2)->static_eval == VALUE_NONE || ss->static_eval > (ss - 2)->static_eval;
+    } else {
+        ss->static_eval = eval = (tt_hit && tte.eval != VALUE_NONE) ? tte.eval : Eval::evaluate(pos);
+        if (tt_hit && std::abs(tte.score) < MATE_BOUND - MAX_PLY
+            && (tte.flag() == EXACT || tte.flag() == (tte.score > eval ? BETA : ALPHA)))
+            eval = tte.score;
+
+        // Better than two plies ago: fail-high pruning is safer, so it
+        // may use smaller margins
+        improving = (ss - 2)->static_eval == VALUE_NONE || ss->static_eval > (ss - 2)->static_eval;
+    }
+
+    if (!in_check && !root && excluded == Move::none()) {
         // RFP (Reverse Futility Pruning)
-        if (depth <= 7 && eval - SP.RFP_Margin * depth >= beta) {
+        if (depth <= 7 && eval - SP.RFP_Margin * (depth - improving) >= beta) {
             return eval;
         }
         
         // Null Move
-        if (do_null && depth >= 3 && eval >= beta) {
+        if (do_null && depth >= 3 && eval >= beta && ss->static_eval >= beta - 20 * depth) {
             StateInfo st;
+            ss->current_move = Move::none();
+            ss->moved_piece = NO_PIECE;
+            ss->cont_hist = td.no_cont_hist();
             pos.make_null_move(st);
             int R = 3 + depth/4;
             int nm = -search(pos, -beta, -beta+1, depth-R-1, ply+1, td, false);
@@ -299,200 +776,491 @@ int search(Position& pos, int alpha, int beta, int depth, int ply, ThreadData& t
             if (stop_search) return 0;
             if (nm >= beta) return beta;
         }
+
+        // ProbCut: a good capture that beats beta by a margin in a reduced
+        // search almost certainly beats beta at full depth. Captures are
+        // screened with SEE and a quiescence search before the real one.
+        int probcut_beta = beta + SP.ProbCut_Margin;
+        if (!pv_node && depth >= PROBCUT_MIN_DEPTH && std::abs(beta) < MATE_BOUND - MAX_PLY
+            && !(tt_hit && tte.depth() >= depth - 3 && value_from_tt(tte.score, ply) < probcut_beta)) {
+            MovePicker pmp(pos, hash_move, probcut_beta - ss->static_eval, td);
+            Move pm;
+            while (pmp.next(pm)) {
+                if (!pos.is_legal(pm)) continue;
+
+                ss->current_move = pm;
+                ss->moved_piece = pos.piece_on(pm.from());
+                ss->cont_hist = &td.cont_history[ss->moved_piece][pm.to()];
+
+                StateInfo st;
+                pos.make_move(pm, st);
+                int s = -qsearch(pos, -probcut_beta, -probcut_beta + 1, ply + 1, td);
+                if (s >= probcut_beta)
+                    s = -search(pos, -probcut_beta, -probcut_beta + 1, depth - 4, ply + 1, td, true);
+                pos.unmake_move(pm);
+                if (stop_search) return 0;
+
+                if (s >= probcut_beta) {
+                    TT.store(pos.hash(), pm, s, ss->static_eval, depth - 3, BETA, ply);
+                    return s;
+                }
+            }
+        }
     }
+
+    // IIR: without a hash move the ordering here is poor, and the node was
+    // likely never searched before. Search it a ply shallower; the next
+    // iteration revisits it with a hash move.
+    if (!root && excluded == Move::none() && depth >= IIR_MIN_DEPTH && hash_move == Move::none())
+        depth--;
     
-    MovePicker mp(pos, hash_move, ply);
+    MovePicker mp(pos, hash_move, ply, td, ss);
     Move m;
     int moves_played = 0;
     int best_score = -INFINITE_SCORE;
     Move best_move = Move::none();
     TTFlag flag = ALPHA;
+    Move quiets_tried[64], captures_tried[32];
+    int quiet_count = 0, capture_count = 0;
     
     while(mp.next(m)) {
+        if (m == excluded) continue;
+        if (root && std::find(td.root_moves.begin() + td.pv_idx, td.root_moves.end(), m) == td.root_moves.end()) continue;
         if (!pos.is_legal(m)) continue;
+
+        // Classify before making the move: afterwards 'to' is always occupied
+        bool capture = pos.is_capture(m);
+        bool losing_capture = capture && !pos.see_ge(m, 0);
+
+        bool gives_check = pos.gives_check(m);
+        int hist = capture ? 0 : mp.quiet_score(pos.side_to_move(), m);
+
+        // Singular extension: if the TT move holds a deep lower bound and
+        // every alternative fails low against a margin below it, the TT move
+        // is the only good one and gets an extra ply. If the alternatives
+        // beat beta as well, several moves refute and the node is cut
+        // (multi-cut).
+        int extension = 0;
+        if (!root && depth >= SINGULAR_MIN_DEPTH && m == hash_move && excluded == Move::none()
+            && tte.flag() != ALPHA && tte.depth() >= depth - 3 && std::abs(tte.score) < MATE_BOUND - MAX_PLY) {
+            int singular_beta = tte.score - 8 * depth;
+            ss->excluded_move = m;
+            int s = search(pos, singular_beta - 1, singular_beta, (depth - 1) / 2, ply, td, false);
+            ss->excluded_move = Move::none();
+            if (stop_search) return 0;
+
+            if (s < singular_beta) extension = 1;
+            else if (singular_beta >= beta) return singular_beta;
+        }
+        int new_depth = depth - 1 + extension;
+
+        // Shallow-depth pruning, only once a move has kept us out of a mate
+        if (!root && best_score > -MATE_BOUND + MAX_PLY) {
+            if (!capture && !gives_check && m.type() != PROMOTION) {
+                // Late move pruning: enough quiets tried, skip the rest
+                if (depth <= LMP_MAX_DEPTH && moves_played >= SP.LMPCount[improving][depth]) {
+                    mp.skip_quiets = true;
+                    continue;
+                }
+
+                // History pruning
+                if (depth <= 3 && hist < -SP.History_Prune * depth) continue;
+
+                // Futility pruning: the static eval is too far below alpha
+                // for a quiet move to make up the difference
+                if (!in_check && depth <= 6 && ss->static_eval + SP.Futility_Margin * (depth + 1) <= alpha) continue;
+
+                // SEE pruning of quiets that hang material
+                if (depth <= 7 && !pos.see_ge(m, -SP.SEE_Quiet_Margin * depth * depth)) continue;
+            } else if (depth <= 6 && losing_capture && !pos.see_ge(m, -SP.SEE_Capture_Margin * depth)) {
+                continue;
+            }
+        }
         
         moves_played++;
-        
-        // Prefetch TT
-        // MCache::prefetch(...)
 
+        ss->current_move = m;
+        ss->moved_piece = pos.piece_on(m.from());
+        ss->cont_hist = &td.cont_history[ss->moved_piece][m.to()];
+
+        long long nodes_before = td.nodes;
         StateInfo st;
         pos.make_move(m, st);
+        TT.prefetch(pos.hash());
         
         int score;
         if (moves_played == 1) {
-            score = -search(pos, -beta, -alpha, depth-1, ply+1, td, true);
+            score = -search(pos, -beta, -alpha, new_depth, ply+1, td, true);
         } else {
-            // LMR
+            // LMR: reduce more when not improving, less in PV nodes and for
+            // moves with good history. Never reduce into the quiescence search.
             int R = 0;
-            if (depth >= 3 && moves_played > 1 && !in_check && !pos.is_capture(m)) {
-                 R = SP.LMR_Base + std::log(moves_played) * std::log(depth) / SP.LMR_Factor;
+            if (depth >= 3 && !in_check && (!capture || losing_capture)) {
+                int r = reduction(depth, moves_played);
+                if (!improving) r += 512;
+                if (pv_node) r -= 1024;
+                r -= hist * 1024 / 8192;
+                R = std::clamp(r / 1024, 0, depth - 2);
             }
             
-            score = -search(pos, -alpha-1, -alpha, depth-1-R, ply+1, td, true);
+            score = -search(pos, -alpha-1, -alpha, new_depth-R, ply+1, td, true);
             if (score > alpha && R > 0) {
-                 score = -search(pos, -alpha-1, -alpha, depth-1, ply+1, td, true);
+                 score = -search(pos, -alpha-1, -alpha, new_depth, ply+1, td, true);
             }
             if (score > alpha && score < beta) {
-                 score = -search(pos, -beta, -alpha, depth-1, ply+1, td, true);
+                 score = -search(pos, -beta, -alpha, new_depth, ply+1, td, true);
             }
         }
         
         pos.unmake_move(m);
         if (stop_search) return 0;
+
+        if (root) {
+            RootMove& rm = *std::find(td.root_moves.begin(), td.root_moves.end(), m);
+            rm.nodes += td.nodes - nodes_before;
+            if (moves_played == 1 || score > alpha) {
+                rm.score = score;
+                rm.pv.assign(1, m);
+                for (int i = 1; i < td.pv_length[1]; ++i) rm.pv.push_back(td.pv_table[1][i]);
+            } else {
+                // Only an upper bound: sort behind the moves with a real score
+                rm.score = -INFINITE_SCORE;
+            }
+        }
         
         if (score > best_score) {
             best_score = score;
             best_move = m;
             if (score > alpha) {
+                if (pv_node) update_pv(td, ply, m);
                 alpha = score;
                 flag = EXACT;
                 if (alpha >= beta) {
-                    if (!pos.is_capture(m)) {
-                        Killers[ply][1] = Killers[ply][0];
-                        Killers[ply][0] = m;
-                        int bonus = depth * depth;
-                        History[pos.side_to_move()][m.from()][m.to()].fetch_add(bonus, std::memory_order_relaxed);
-                    }
-                    TT.store(pos.hash(), m, beta, depth, BETA, ply);
+                    update_cutoff_stats(pos, td, ss, ply, m, depth,
+                                        quiets_tried, quiet_count, captures_tried, capture_count);
+                    if (excluded == Move::none())
+                        TT.store(pos.hash(), m, beta, ss->static_eval, depth, BETA, ply);
                     return beta;
                 }
             }
         }
+
+        if (!capture && quiet_count < 64) quiets_tried[quiet_count++] = m;
+        else if (capture && capture_count < 32) captures_tried[capture_count++] = m;
     }
     
-    if (moves_played == 0) return in_check ? -MATE_BOUND + ply : 0;
+    // With a move excluded, no moves left only means the alternatives are gone
+    if (moves_played == 0) return excluded != Move::none() ? alpha : in_check ? -MATE_BOUND + ply : 0;
     
-    TT.store(pos.hash(), best_move, best_score, depth, flag, ply);
+    if (excluded == Move::none())
+        TT.store(pos.hash(), best_move, best_score, ss->static_eval, depth, flag, ply);
     return best_score;
 }
 
 // --- Root ---
 
-void iterate(Position& pos, Limits limits) {
-    refresh_params();
-    stop_search = false;
-    start_time = std::chrono::steady_clock::now();
-    nodes_searched = 0;
-    
-    // Clear heuristics if new game? 
-    // std::memset(Killers, 0, sizeof(Killers)); 
+// Lazy SMP depth schedule: helper i searches only the depths where
+// ((depth + ply) / SkipSize) + SkipPhase is even, so threads spread over
+// neighbouring depths instead of all repeating the same iteration.
+const int SkipSize[]  = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+const int SkipPhase[] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
 
-    run_infinite = limits.infinite;
-    time_hard_limit = limits.time; 
-    time_soft_limit = time_hard_limit / 2; // Simple heuristic
-    
-    if (limits.use_time && !limits.is_movetime) {
-         // Standard: Time / MovesLeft
-         int moves = limits.movestogo > 0 ? limits.movestogo : 25;
-         long long t = limits.time / moves + limits.inc;
-         time_soft_limit = t;
-         time_hard_limit = t * 5; 
-         if (time_hard_limit > limits.time) time_hard_limit = limits.time - 50;
-    }
-    
-    if (time_hard_limit < 10 && limits.use_time) time_hard_limit = 10;
-    
-    int num_threads = Tune::get("Threads");
-    thread_pool.init(num_threads);
-    std::vector<std::unique_ptr<ThreadData>> tds;
-    for(int i=0; i<num_threads; ++i) tds.push_back(std::make_unique<ThreadData>(i));
-    
-    if (num_threads > 1) {
-        thread_pool.start_search([&](int id) {
-            if (id == 0) return;
-            int a = -INFINITE_SCORE, b = INFINITE_SCORE;
-            for(int d=1; d<=MAX_PLY; ++d) {
-                if(stop_search) break;
-                search(pos, a, b, d, 0, *tds[id], true);
-            }
-        });
+bool skip_depth(const ThreadData& td, int depth) {
+    if (td.id == 0) return false;
+    int i = (td.id - 1) % 20;
+    return ((depth + td.root_pos.history_index) / SkipSize[i] + SkipPhase[i]) % 2;
+}
+
+// One info line per MultiPV slot, best first
+// UCI score: "mate N" in moves, negative when we are mated, else centipawns
+std::string score_to_uci(int v) {
+    if (v >= MATE_BOUND - MAX_PLY) return "mate " + std::to_string((MATE_BOUND - v + 1) / 2);
+    if (v <= -(MATE_BOUND - MAX_PLY)) return "mate " + std::to_string(-(MATE_BOUND + v) / 2);
+    return "cp " + std::to_string(v);
+}
+
+void report(ThreadData& td, int depth) {
+    long long nodes = total_nodes();
+    long long ms = elapsed_ms(nodes);
+
+    for (int i = 0; i < multi_pv; ++i) {
+        const RootMove& rm = td.root_moves[i];
+        std::ostringstream info;
+        info << "info depth " << depth << " seldepth " << td.sel_depth << " multipv " << i + 1
+             << " score " << score_to_uci(rm.score)
+             << " nodes " << nodes << " nps " << (nodes*1000/ms)
+             << " time " << ms << " hashfull " << TT.hashfull() << " pv";
+        for(Move m : rm.pv) info << " " << m.to_string();
+        Misc::out(info.str());
     }
-    
-    Move best_move = Move::none();
-    int alpha = -INFINITE_SCORE;
-    int beta = INFINITE_SCORE;
-    int score = 0;
+}
+
+// Iterative deepening with aspiration windows, run by every thread. Only
+// the main thread reports and decides when to stop on time. With MultiPV,
+// each slot is a root search over the moves not yet placed, windowed
+// around that slot's score from the previous iteration.
+void iterative_deepening(ThreadData& td, const Limits& limits) {
+    Position& pos = td.root_pos;
+    auto& rms = td.root_moves;
+
+    if (rms.empty()) return;
     
     for(int depth = 1; depth <= limits.depth || limits.depth == 0; ++depth) {
-        if (depth >= MAX_PLY) break;
-        
-        // Aspiration
-        if (depth >= 5) {
+        if (depth >= MAX_PLY || stop_search) break;
+        if (skip_depth(td, depth)) continue;
+
+        for (auto& rm : rms) rm.previous_score = rm.score;
+        td.sel_depth = 0;
+
+        for (td.pv_idx = 0; td.pv_idx < multi_pv && !stop_search; ++td.pv_idx) {
+            int prev = rms[td.pv_idx].previous_score;
+            int alpha = -INFINITE_SCORE;
+            int beta = INFINITE_SCORE;
             int delta = 20;
-            alpha = std::max(-INFINITE_SCORE, score - delta);
-            beta = std::min(INFINITE_SCORE, score + delta);
-            
-            while(true) {
-                 score = search(pos, alpha, beta, depth, 0, *tds[0], true);
-                 if (stop_search) break;
-                 
-                 if (score <= alpha) {
-                     beta = (alpha + beta) / 2;
-                     alpha = std::max(-INFINITE_SCORE, alpha - delta*2);
-                 } else if (score >= beta) {
-                     beta = std::min(INFINITE_SCORE, beta + delta*2);
-                 } else {
-                     break;
-                 }
-                 delta += delta/2;
+
+            // Aspiration
+            if (depth >= 5 && prev != -INFINITE_SCORE) {
+                alpha = std::max(-INFINITE_SCORE, prev - delta);
+                beta = std::min(INFINITE_SCORE, prev + delta);
             }
-        } else {
-            alpha = -INFINITE_SCORE; beta = INFINITE_SCORE;
-            score = search(pos, alpha, beta, depth, 0, *tds[0], true);
+
+            while (true) {
+                int score = search(pos, alpha, beta, depth, 0, td, true);
+                if (stop_search) break;
+                std::stable_sort(rms.begin() + td.pv_idx, rms.end());
+
+                if (score <= alpha && alpha > -INFINITE_SCORE) {
+                    beta = (alpha + beta) / 2;
+                    alpha = std::max(-INFINITE_SCORE, alpha - delta*2);
+                } else if (score >= beta && beta < INFINITE_SCORE) {
+                    beta = std::min(INFINITE_SCORE, beta + delta*2);
+                } else {
+                    break;
+                }
+                delta += delta/2;
+            }
+
+            // Slots found so far stay ordered by score
+            std::stable_sort(rms.begin(), rms.begin() + td.pv_idx + 1);
         }
         
         if (stop_search) break;
-        
-        // Stats
-        long long nodes = 0;
-        for(auto& t : tds) nodes += t->nodes;
-        auto now = std::chrono::steady_clock::now();
-        long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
-        if (ms == 0) ms = 1;
-        
-        // PV Extraction
-        std::vector<Move> pv;
-        TTEntry tte;
-        Position p_sim = pos;
-        for(int i=0; i<depth; ++i) {
-             if (TT.probe(p_sim.hash(), tte) && tte.move != Move::none()) {
-                 if (p_sim.is_legal(tte.move)) {
-                     pv.push_back(tte.move);
-                     StateInfo st;
-                     p_sim.make_move(tte.move, st);
-                 } else break;
-             } else break;
+
+        td.best_move = rms[0].move;
+        td.best_score = rms[0].score;
+        td.completed_depth = depth;
+
+        if (td.id != 0) continue;
+
+        report(td, depth);
+
+        long long nodes = td.nodes.load(std::memory_order_relaxed);
+        SearchInfo info;
+        info.depth = depth;
+        info.seldepth = td.sel_depth;
+        info.nodes = total_nodes();
+        info.time_ms = static_cast<int>(elapsed_ms(info.nodes));
+        info.score = rms[0].score;
+        info.best_move = rms[0].move;
+        info.best_move_effort = nodes ? static_cast<double>(rms[0].nodes) / nodes : 0.0;
+
+        if (ClercX::Time.should_stop(info)) {
+            // Keep pondering; the search ends at ponderhit instead. Checked
+            // and flagged under the lock ponderhit() takes, so a ponderhit
+            // either sees the flag or has already cleared pondering.
+            std::lock_guard<std::mutex> lk(wait_mutex);
+            if (!pondering) break;
+            stop_on_ponderhit = true;
         }
-        if (!pv.empty()) best_move = pv[0];
-        
-        std::cout << "info depth " << depth << " seldepth " << depth 
-                  << " score cp " << score 
-                  << " nodes " << nodes << " nps " << (nodes*1000/ms)
-                  << " time " << ms << " pv";
-        for(Move m : pv) std::cout << " " << m.to_string();
-        std::cout << std::endl;
-        
-        if (limits.use_time && !limits.is_movetime && ms > time_soft_limit) break;
     }
-    
-    stop_search = true;
+}
+
+// Each thread votes for its best move, weighted by how deep it got and how
+// much better its score is than the worst one. A thread that found a
+// shorter mate wins outright.
+ThreadData* pick_best_thread() {
+    ThreadData* best = thread_data[0].get();
+    if (thread_data.size() == 1 || multi_pv > 1) return best;
+
+    int min_score = INFINITE_SCORE;
+    for(auto& t : thread_data)
+        if (t->completed_depth > 0) min_score = std::min(min_score, t->best_score.load());
+
+    std::vector<std::pair<Move, long long>> votes;
+    auto vote = [&](Move m) -> long long& {
+        for(auto& v : votes) if (v.first == m) return v.second;
+        votes.emplace_back(m, 0);
+        return votes.back().second;
+    };
+    for(auto& t : thread_data)
+        if (t->completed_depth > 0)
+            vote(t->best_move) += static_cast<long long>(t->best_score - min_score + 14) * t->completed_depth;
+
+    for(auto& t : thread_data) {
+        ThreadData* th = t.get();
+        if (th->completed_depth == 0) continue;
+        if (best->completed_depth == 0) { best = th; continue; }
+
+        if (th->best_score >= MATE_BOUND - MAX_PLY) {
+            if (th->best_score > best->best_score) best = th;
+        } else if (best->best_score < MATE_BOUND - MAX_PLY) {
+            long long vt = vote(th->best_move), vb = vote(best->best_move);
+            if (vt > vb || (vt == vb && th->completed_depth > best->completed_depth)) best = th;
+        }
+    }
+    return best;
+}
+
+// Move to ponder on: the second move of the best line, or the TT move
+// after the best move when the line stops short
+Move expected_reply(Position& pos, const ThreadData& td, Move best_move) {
+    if (best_move == Move::none()) return Move::none();
+
+    auto rm = std::find(td.root_moves.begin(), td.root_moves.end(), best_move);
+    if (rm != td.root_moves.end() && rm->pv.size() > 1) return rm->pv[1];
+
+    Move reply = Move::none();
+    StateInfo st;
+    pos.make_move(best_move, st);
+    TTEntry tte;
+    if (TT.probe(pos.hash(), tte) && tte.move != Move::none()
+        && pos.is_pseudo_legal(tte.move) && pos.is_legal(tte.move))
+        reply = tte.move;
+    pos.unmake_move(best_move);
+    return reply;
+}
+
+void wait() {
     thread_pool.wait_for_completion();
-    
+}
+
+// Job of pool thread 0: searches, holds the answer back while pondering or
+// in "go infinite", then collects the helpers and prints bestmove
+void main_search(const Limits& limits) {
+    ThreadData& main = *thread_data[0];
+    iterative_deepening(main, limits);
+
+    {
+        std::unique_lock<std::mutex> lk(wait_mutex);
+        wait_cv.wait(lk, [&] { return stop_search || !(pondering || limits.infinite); });
+    }
+    pondering = false;
+
+    stop_search = true;
+    thread_pool.wait_for_helpers();
+
+    nodes_searched = total_nodes();
+
+    // Exact totals, including the iteration cut short by the stop
+    long long ms = elapsed_ms(nodes_searched);
+    Misc::out("info nodes " + std::to_string(nodes_searched.load()) + " nps "
+              + std::to_string(nodes_searched * 1000 / ms) + " time " + std::to_string(ms));
+
+    if (main.root_moves.empty()) {
+        Misc::out(std::string("info depth 0 score ") + (main.root_pos.checkers() ? "mate 0" : "cp 0"));
+        Misc::out("bestmove 0000");
+        return;
+    }
+
+    // Without a completed iteration, fall back to the main thread's list
+    ThreadData* best = pick_best_thread();
+    Move best_move = best->best_move;
     if (best_move == Move::none()) {
-         MoveGen::MoveList moves;
-         MoveGen::generate<MoveGen::ALL>(pos, moves);
-         if (moves.count > 0) best_move = moves[0];
+        best = &main;
+        best_move = main.root_moves[0].move;
+    }
+
+    std::string line = "bestmove " + best_move.to_string();
+    Move ponder_move = expected_reply(main.root_pos, *best, best_move);
+    if (ponder_move != Move::none()) line += " ponder " + ponder_move.to_string();
+    Misc::out(line);
+}
+
+void start(Position& pos, Limits limits) {
+    // The previous search must be over before its thread data is reused
+    wait();
+
+    refresh_params();
+    stop_search = false;
+    stop_on_ponderhit = false;
+    pondering = limits.ponder;
+    nodes_searched = 0;
+    TT.new_search();
+
+    node_limit = limits.nodes;
+    ClercX::Time.init(limits, pos.side_to_move(), pos.history_index);
+
+    MoveGen::MoveList legal;
+    MoveGen::generate<MoveGen::LEGAL>(pos, legal);
+
+    // "go searchmoves": restrict the root, ignoring moves that are not legal
+    std::vector<Move> root_list;
+    for (Move m : legal)
+        if (limits.searchmoves.empty()
+            || std::find(limits.searchmoves.begin(), limits.searchmoves.end(), m) != limits.searchmoves.end())
+            root_list.push_back(m);
+    if (root_list.empty()) root_list.assign(legal.begin(), legal.end());
+
+    multi_pv = std::clamp(static_cast<int>(ClercX::Options["MultiPV"]), 1, std::max(1, static_cast<int>(root_list.size())));
+
+    int num_threads = Tune::get("Threads");
+    init_threads(num_threads);
+    for(auto& t : thread_data) {
+        t->nodes = 0;
+        t->age();
+        t->root_pos.copy_from(pos, t->root_state);
+        t->completed_depth = 0;
+        t->best_score = -INFINITE_SCORE;
+        t->best_move = Move::none();
+        t->root_moves.clear();
+        for (Move m : root_list) t->root_moves.emplace_back(m);
+        for(int i=0; i<2; ++i) {
+            t->stack[i].ply = i - 2;
+            t->stack[i].static_eval = VALUE_NONE;
+            t->stack[i].current_move = t->stack[i].excluded_move = Move::none();
+            t->stack[i].moved_piece = NO_PIECE;
+            t->stack[i].cont_hist = t->no_cont_hist();
+        }
     }
     
-    std::cout << "bestmove " << best_move.to_string() << std::endl;
+    thread_pool.start_search([limits](int id) {
+        if (id == 0) main_search(limits);
+        else iterative_deepening(*thread_data[id], limits);
+        Eval::publish_cache_stats();
+    });
+}
+
+void iterate(Position& pos, Limits limits) {
+    start(pos, limits);
+    wait();
+}
+
+void stop() {
+    {
+        std::lock_guard<std::mutex> lk(wait_mutex);
+        stop_search = true;
+    }
+    wait_cv.notify_all();
+}
+
+void ponderhit() {
+    {
+        std::lock_guard<std::mutex> lk(wait_mutex);
+        pondering = false;
+        if (stop_on_ponderhit) stop_search = true;
+    }
+    wait_cv.notify_all();
+}
+
+void init() {
+    init_reductions();
+    Tune::on_change([](const std::string& name) {
+        if (name == "LMR_Base" || name == "LMR_Factor") init_reductions();
+    });
 }
 
 void clear() {
-    for(int c=0; c<COLOR_NB; ++c)
-        for(int f=0; f<SQ_NB; ++f)
-            for(int t=0; t<SQ_NB; ++t)
-                History[c][f][t] = 0;
+    for(auto& t : thread_data) t->clear();
     TT.clear();
 }
 
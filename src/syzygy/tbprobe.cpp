@@ -5,7 +5,6 @@
 #include "zobrist.h"
 #include "misc.h"
 
-#include <iostream>
 #include <vector>
 #include <string>
 #include <atomic>
@@ -172,8 +171,8 @@ void init(const std::string& path) {
 
     if (wdl_count > 0) {
         tb_ctx.max_pieces = MAX_TB_PIECES; // Assume we found up to N pieces
-        std::cout << "info string Syzygy: Found " << wdl_count << " WDL and " << dtz_count << " DTZ tables." << std::endl;
-        std::cout << "info string Syzygy: Cache initialized " << CACHE_SIZE_MB << "MB" << std::endl;
+        Misc::log("Syzygy: Found " + std::to_string(wdl_count) + " WDL and " + std::to_string(dtz_count) + " DTZ tables.");
+        Misc::log("Syzygy: Cache initialized " + std::to_string(CACHE_SIZE_MB) + "MB");
     }
     
     // Reset stats
@@ -1,87 +1,73 @@
 #include "../include/timeman.h"
 #include "../include/ucioption.h"
+#include "../include/misc.h"
 #include <algorithm>
-#include <iostream>
 
 namespace ClercX {
 
 TimeManager Time;
 
-int64_t now() {
-    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-}
-
 void TimeManager::init(const Search::Limits& limits, Color, int) {
-    startTime = now();
-    optTime = 0;
-    maxTime = 0;
-    
-    infinite = false; // limits.infinite; // Assuming Limits has this
-    moveTime = 0; // limits.movetime;
-    movesToGo = limits.movestogo > 0 ? limits.movestogo : 35; // Default to 35 if not specified or 0 (sudden deathish)
-    wTime = limits.time; // Assuming limits has wtime/btime distinction or handled before
-    bTime = limits.time; // This logic needs alignment with how Limits is passed. 
-    // In uci.cpp, limits.time is set based on side to move. 
-    // Let's assume limits.time is the time for 'us'.
-    
-    int64_t myTime = limits.time;
-    int64_t myInc = limits.inc;
-    
+    startTime = Misc::now();
+    timed = limits.use_time;
+    moveTime = limits.is_movetime;
     depthLimit = limits.depth;
-    // nodesLimit = limits.nodes; // Assuming Search::Limits has nodes
-    
-    if (limits.use_time) {
-        // Basic allocation
-        // Formula: optimum = (time + inc*40)/moves_remaining * stability_factor
-        // Actually, typically (time / moves_remaining) + inc
-        
-        // Let's use the user's requested formula structure if possible, but adjusted for standard chess engines.
-        // User asked: optimum = (time + inc*40)/moves_remaining * stability_factor
-        
-        // Standard moves_remaining guess if unknown
-        int mtg = limits.movestogo > 0 ? limits.movestogo : 40;
-        
-        // Reserve some time
-        int64_t overhead = static_cast<int>(Options["Move Overhead"]);
-        myTime = std::max<int64_t>(0, myTime - overhead);
-
-        optTime = (myTime + myInc * (mtg - 1)) / mtg; // Simplified
-        // Or user formula: 
-        // optTime = (myTime + myInc * 40) / mtg; // If we assume 40 moves horizon? 
-        
-        // Let's stick to a robust standard first:
-        double base = (myTime / static_cast<double>(mtg)) + myInc;
-        optTime = static_cast<int64_t>(base);
-
-        maxTime = std::min<int64_t>(myTime, optTime * 5);
-    } else {
-        // Fixed time or infinite
-        if (moveTime > 0) {
-            optTime = maxTime = moveTime;
-        } else {
-            // Infinite or depth/nodes based
-            optTime = maxTime = 24*60*60*1000; // Very long
-        }
+    nodesLimit = limits.nodes;
+    nodesPerMs = timed ? static_cast<int>(Options["nodestime"]) : 0;
+
+    lastBestMove = Move::none();
+    lastScore = 0;
+    stableIterations = 0;
+    bestMoveChanges = 0;
+
+    if (!timed) {
+        optTime = maxTime = 0;
+        return;
+    }
+
+    // Time lost to the GUI and the wire is never ours to spend
+    int64_t overhead = static_cast<int>(Options["Move Overhead"]);
+    int64_t avail = std::max<int64_t>(1, limits.time - overhead);
+
+    if (moveTime) {
+        optTime = maxTime = avail;
+        return;
     }
+
+    // Sudden death is planned as 40 more moves; increments are banked at
+    // three quarters so a late slowdown cannot flag
+    int mtg = limits.movestogo > 0 ? static_cast<int>(std::min<long long>(limits.movestogo, 40)) : 40;
+    optTime = std::min<int64_t>(avail / mtg + limits.inc * 3 / 4, avail * 4 / 5);
+    maxTime = std::min(optTime * 5, avail * 4 / 5);
+    optTime = std::max<int64_t>(1, optTime);
+    maxTime = std::max(optTime, maxTime);
 }
 
 bool TimeManager::should_stop(const Search::SearchInfo& info) {
-    if (infinite) return false;
-    
-    // Check limits
+    // Feedback is tracked on every iteration, also while pondering
+    bool changed = lastBestMove != Move::none() && info.best_move != lastBestMove;
+    bestMoveChanges = bestMoveChanges / 2 + (changed ? 1 : 0);
+    stableIterations = changed ? 0 : stableIterations + 1;
+    int scoreDrop = lastBestMove != Move::none() ? lastScore - info.score : 0;
+    lastBestMove = info.best_move;
+    lastScore = info.score;
+
     if (depthLimit > 0 && info.depth >= depthLimit) return true;
-    // if (nodesLimit > 0 && info.nodes >= nodesLimit) return true;
-    
-    if (maxTime == 0) return false; // Infinite
-    
-    int64_t t = elapsed();
-    if (t >= maxTime) return true;
-    
-    // Flexible stop: if we used optimum time and result is stable, stop.
-    // This requires feedback from search (e.g., best move stability).
-    // For now, hard stop at maxTime, soft stop logic usually in search loop.
-    
-    return false;
+    if (nodesLimit > 0 && info.nodes >= nodesLimit) return true;
+    if (!timed || moveTime) return false;
+
+    // A settled best move lets the search stop early; a new best move or
+    // a falling score asks for more time
+    double stability = 1.2 - 0.1 * std::min(stableIterations, 6);
+    double instability = 1.0 + 0.6 * bestMoveChanges;
+    double falling = std::clamp(1.0 + scoreDrop / 100.0, 0.7, 1.6);
+
+    // When nearly all root nodes went into the best move, the
+    // alternatives were refuted quickly and it is unlikely to change
+    double effort = std::clamp(1.6 - info.best_move_effort, 0.6, 1.2);
+
+    double scale = stability * instability * falling * effort;
+    return elapsed(info.nodes) > std::min<int64_t>(maxTime, static_cast<int64_t>(optTime * scale));
 }
 
 int64_t TimeManager::optimum_time() const {
@@ -92,8 +78,9 @@ int64_t TimeManager::maximum_time() const {
     return maxTime;
 }
 
-int64_t TimeManager::elapsed() const {
-    return now() - startTime;
+int64_t TimeManager::elapsed(int64_t nodes) const {
+    if (nodesPerMs) return nodes / nodesPerMs;
+    return Misc::now() - startTime;
 }
 
 } // namespace ClercX
@@ -1,12 +1,15 @@
 #include "tt.h"
 #include "mcache.h"
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <new>
+#include <thread>
+#include <vector>
 
 TranspositionTable TT(16); // Default 16MB
 
-TranspositionTable::TranspositionTable(size_t size_mb) : generation(0), table(nullptr) {
+TranspositionTable::TranspositionTable(size_t size_mb) : table(nullptr), cluster_count(0), generation(0) {
     resize(size_mb);
 }
 
@@ -16,82 +19,135 @@ TranspositionTable::~TranspositionTable() {
 
 void TranspositionTable::resize(size_t size_mb) {
     if (table) MCache::aligned_free(table);
-    
-    // Ensure size is power of 2 for fast modulo/masking
-    // But we use modulo currently: key % entry_count.
-    // Ideally we'd use power of 2 size.
-    
+
     size_t size_bytes = size_mb * 1024 * 1024;
-    entry_count = size_bytes / sizeof(TTEntry);
-    
+    cluster_count = size_bytes / sizeof(TTCluster);
+
     // Allocate 2MB aligned memory
-    table = static_cast<TTEntry*>(MCache::aligned_alloc(entry_count * sizeof(TTEntry), 2 * 1024 * 1024));
-    
+    table = static_cast<TTCluster*>(MCache::aligned_alloc(cluster_count * sizeof(TTCluster), 2 * 1024 * 1024));
+
     if (!table) {
         std::cerr << "Failed to allocate TT with huge pages, falling back to standard alignment" << std::endl;
-        table = static_cast<TTEntry*>(MCache::aligned_alloc(entry_count * sizeof(TTEntry), 4096));
+        table = static_cast<TTCluster*>(MCache::aligned_alloc(cluster_count * sizeof(TTCluster), 4096));
     }
-    
+
+    if (!table) cluster_count = 0;
+
     clear();
 }
 
 void TranspositionTable::clear() {
-    if (table) std::memset(static_cast<void*>(table), 0, entry_count * sizeof(TTEntry));
     generation = 0;
+    if (!table) return;
+
+    // Multi-GB tables take seconds to zero on one core; split the memset.
+    size_t bytes = cluster_count * sizeof(TTCluster);
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    if (bytes < (64ULL << 20)) workers = 1;
+
+    size_t chunk = (cluster_count + workers - 1) / workers;
+    std::vector<std::thread> pool;
+    for (size_t i = 0; i < workers; ++i) {
+        size_t start = i * chunk;
+        if (start >= cluster_count) break;
+        size_t len = std::min(chunk, cluster_count - start);
+        pool.emplace_back([this, start, len]() {
+            std::memset(static_cast<void*>(table + start), 0, len * sizeof(TTCluster));
+        });
+    }
+    for (auto& t : pool) t.join();
 }
 
 void TranspositionTable::new_search() {
-    generation++;
+    generation += GENERATION_DELTA;
 }
 
 void TranspositionTable::prefetch(uint64_t key) {
-    if (table) MCache::prefetch(&table[key % entry_count]);
+    if (table) MCache::prefetch(cluster(key));
 }
 
-void TranspositionTable::store(uint64_t key, Move m, int score, int depth, TTFlag flag, int ply) {
+void TranspositionTable::store(uint64_t key, Move m, int score, int eval, int depth, TTFlag flag, int ply) {
     if (!table) return;
 
-    if (score > 29000) score += ply;
-    else if (score < -29000) score -= ply;
+    score = value_to_tt(score, ply);
+
+    uint16_t key16 = static_cast<uint16_t>(key);
+    TTEntry* tte = cluster(key)->entry;
+    TTEntry* replace = &tte[0];
 
-    size_t idx = key % entry_count;
-    TTEntry& entry = table[idx];
-    
     // Replacement strategy:
-    // 1. Different key (Always replace, it's a collision)
-    // 2. Exact match from this search (Update better info)
-    // 3. Deeper depth (Always replace)
-    
-    bool replace = false;
-    if (entry.key != key) replace = true;
-    else if (depth >= entry.depth) replace = true;
-    else if (entry.age != generation) replace = true; // Old entry
-    
-    if (replace) {
-        // Save move if we are overwriting a valuable entry with a worse one?
-        // No, in standard simple TT, just overwrite.
-        
-        // Preserve move if new one is NONE but old one was valid?
-        if (m == Move::none()) m = entry.move;
-
-        entry.key = key;
-        entry.move = m;
-        entry.score = static_cast<int16_t>(score);
-        entry.depth = static_cast<int8_t>(depth);
-        entry.flag = static_cast<int8_t>(flag);
-        entry.age = generation;
+    // 1. Slot already holding this position (or an empty slot)
+    // 2. Otherwise the slot with the lowest depth, where each search
+    //    generation of age costs the same as two plies of depth
+    int best_worth = 1 << 30;
+    for (int i = 0; i < CLUSTER_SIZE; ++i) {
+        TTEntry& e = tte[i];
+        if (e.depth8 == 0 || (e.key16 ^ e.checksum()) == key16) {
+            replace = &e;
+            break;
+        }
+        // Generations step by GENERATION_DELTA; count them one at a time
+        int age = ((GENERATION_CYCLE + generation - e.gen_bound) & GENERATION_MASK) / GENERATION_DELTA;
+        int worth = e.depth8 - 2 * age;
+        if (worth < best_worth) {
+            best_worth = worth;
+            replace = &e;
+        }
     }
+
+    TTEntry entry = *replace;
+    bool same = entry.depth8 != 0 && (entry.key16 ^ entry.checksum()) == key16;
+
+    // Keep a deeper entry of the same position from this search unless the
+    // new result is exact.
+    if (same && flag != EXACT && depth - DEPTH_OFFSET + 4 <= entry.depth8 && entry.generation() == generation) return;
+
+    // Preserve move if new one is NONE but old one was valid
+    if (m == Move::none() && same) m = entry.move;
+
+    entry.move = m;
+    entry.score = static_cast<int16_t>(score);
+    entry.eval = static_cast<int16_t>(eval);
+    entry.depth8 = static_cast<uint8_t>(depth - DEPTH_OFFSET);
+    entry.gen_bound = static_cast<uint8_t>(generation | flag);
+    entry.key16 = key16 ^ entry.checksum();
+
+    *replace = entry;
 }
 
 bool TranspositionTable::probe(uint64_t key, TTEntry& entry) {
     if (!table) return false;
-    
-    size_t idx = key % entry_count;
-    const TTEntry& tte = table[idx];
-    
-    if (tte.key == key) {
-        entry = tte;
+
+    uint16_t key16 = static_cast<uint16_t>(key);
+    TTEntry* tte = cluster(key)->entry;
+
+    for (int i = 0; i < CLUSTER_SIZE; ++i) {
+        // Copy first: other threads may be writing this slot concurrently.
+        TTEntry e = tte[i];
+        if (e.depth8 == 0 || (e.key16 ^ e.checksum()) != key16) continue;
+
+        // Refresh the age so hits from earlier searches are not evicted first
+        if (e.generation() != generation) {
+            e.gen_bound = static_cast<uint8_t>(generation | e.flag());
+            e.key16 = key16 ^ e.checksum();
+            tte[i] = e;
+        }
+
+        entry = e;
+        entry.key16 = key16;
         return true;
     }
     return false;
-}
\ No newline at end of file
+}
+
+int TranspositionTable::hashfull() const {
+    if (!table) return 0;
+
+    size_t sample = std::min<size_t>(1000, cluster_count);
+    int cnt = 0;
+    for (size_t i = 0; i < sample; ++i)
+        for (int j = 0; j < CLUSTER_SIZE; ++j)
+            if (table[i].entry[j].depth8 && table[i].entry[j].generation() == generation) cnt++;
+
+    return sample ? static_cast<int>(cnt * 1000 / (sample * CLUSTER_SIZE)) : 0;
+}
@@ -1,10 +1,12 @@
 #include "tune.h"
-#include <iostream>
+#include "misc.h"
 #include <sstream>
+#include <vector>
 
 namespace Tune {
 
 std::map<std::string, Parameter> params;
+std::vector<std::function<void(const std::string&)>> listeners;
 
 void add(const std::string& name, int value, int min = 0, int max = 1000, int step = 1) {
     params[name] = {value, min, max, step};
@@ -12,11 +14,16 @@ void add(const std::string& name, int value, int min = 0, int max = 1000, int st
 
 void init() {
     // --- Search Parameters ---
-    add("LMR_Base", 4, 1, 10);
-    add("LMR_Factor", 4, 1, 10);
+    add("LMR_Base", 75, 0, 300);     // Reduction = LMR_Base/100 + ln(d) ln(m) / (LMR_Factor/100)
+    add("LMR_Factor", 225, 100, 500);
     add("Futility_Margin", 100, 50, 500);
     add("RFP_Margin", 75, 25, 200);
     add("ASP_Window", 25, 10, 100);
+    add("LMP_Base", 3, 1, 10);          // Quiets searched at depth d: (LMP_Base + d*d) / (2 - improving)
+    add("History_Prune", 4000, 0, 16384); // Skip quiets with history below -History_Prune * depth
+    add("SEE_Quiet_Margin", 20, 0, 200);  // Quiets must not lose more than margin * depth^2
+    add("SEE_Capture_Margin", 100, 0, 400); // Captures must not lose more than margin * depth
+    add("ProbCut_Margin", 200, 50, 500);  // ProbCut beta = beta + margin
     
     // --- Evaluation: Material ---
     add("Pawn_MG", 82, 50, 150);   add("Pawn_EG", 94, 50, 150);
@@ -35,6 +42,9 @@ void init() {
     add("Pawn_Passed_MG", 10, 0, 100); add("Pawn_Passed_EG", 20, 0, 100);
     add("Pawn_Iso_MG", -10, -50, 0);   add("Pawn_Iso_EG", -15, -50, 0);
     add("Pawn_Double_MG", -10, -50, 0);add("Pawn_Double_EG", -15, -50, 0);
+
+    // --- Evaluation: Imbalance ---
+    add("Bishop_Pair_MG", 25, 0, 100); add("Bishop_Pair_EG", 45, 0, 100);
     
     // --- Evaluation: King Safety ---
     add("Safety_Weight", 100, 50, 200); // Percentage
@@ -46,6 +56,7 @@ void init() {
 void set(const std::string& name, int value) {
     if (params.find(name) != params.end()) {
         params[name].value = value;
+        for (auto& listener : listeners) listener(name);
     }
 }
 
@@ -56,10 +67,14 @@ int get(const std::string& name) {
     return 0;
 }
 
+void on_change(std::function<void(const std::string&)> listener) {
+    listeners.push_back(std::move(listener));
+}
+
 void print_params() {
     for (const auto& [name, p] : params) {
-        std::cout << "option name " << name << " type spin default " << p.value 
-                  << " min " << p.min << " max " << p.max << std::endl;
+        Misc::out("option name " + name + " type spin default " + std::to_string(p.value)
+                  + " min " + std::to_string(p.min) + " max " + std::to_string(p.max));
     }
 }
 
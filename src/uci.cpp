@@ -6,6 +6,10 @@
 #include "tune.h"
 #include "bitboard.h"
 #include "tt.h"
+#include "evaluate.h"
+#include "perft.h"
+#include "bench.h"
+#include "misc.h"
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -15,6 +19,28 @@
 
 namespace UCI {
 
+namespace {
+
+// Legal move in UCI notation, Move::none() if there is none
+Move to_move(const Position& pos, const std::string& str) {
+    MoveGen::MoveList legal;
+    MoveGen::generate<MoveGen::LEGAL>(pos, legal);
+    for (Move m : legal)
+        if (m.to_string() == str) return m;
+    return Move::none();
+}
+
+void print_option(const std::string& name) {
+    const ClercX::Option& o = ClercX::Options[name];
+    std::ostringstream line;
+    line << "option name " << name << " type " << o.get_type();
+    if (o.get_type() != "button") line << " default " << o.get_default();
+    if (o.get_type() == "spin") line << " min " << o.get_min() << " max " << o.get_max();
+    Misc::out(line.str());
+}
+
+} // namespace
+
 void loop() {
     Position pos;
     // Use deque for stable pointers
@@ -22,20 +48,43 @@ void loop() {
     
     pos.set_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
     
+    // Searches run on the thread pool, so this loop keeps reading stop,
+    // ponderhit and isready while they think. All output goes through the
+    // Misc::out queue, in the order it was queued.
+    auto wait_for_search = [] {
+        Search::wait();
+        Misc::flush_out();
+    };
+
     std::string line, token;
     while (std::getline(std::cin, line)) {
         std::stringstream ss(line);
+        token.clear();
         ss >> token;
+
+        // These change state the search reads, so end it first. A go infinite
+        // or ponder search would never finish on its own; it still prints
+        // its bestmove before the command runs.
+        if (token == "setoption" || token == "ucinewgame" || token == "position" || token == "go"
+            || token == "divide" || token == "bench" || token == "perftsuite" || token == "eval") {
+            Search::stop();
+            wait_for_search();
+        }
         
         if (token == "uci") {
-            std::cout << "id name ClercX S+++" << std::endl;
-            std::cout << "id author Gemini Agent" << std::endl;
+            Misc::out("id name ClercX S+++");
+            Misc::out("id author Gemini Agent");
             
             Tune::print_params();
             
-            std::cout << "option name Hash type spin default 16 min 1 max 8192" << std::endl;
-            std::cout << "option name Threads type spin default 1 min 1 max 128" << std::endl;
-            std::cout << "uciok" << std::endl;
+            print_option("Hash");
+            print_option("Clear Hash");
+            Misc::out("option name Threads type spin default 1 min 1 max 128");
+            print_option("MultiPV");
+            print_option("Ponder");
+            print_option("Move Overhead");
+            print_option("nodestime");
+            Misc::out("uciok");
         } else if (token == "setoption") {
             std::string name, value;
             std::string sub;
@@ -53,20 +102,18 @@ void loop() {
                         Tune::set(name, std::stoi(value));
                     } catch (...) {}
                 }
-                
-                if (name == "Hash") {
-                    try {
-                        TT.resize(std::stoi(value));
-                    } catch (...) {}
-                }
-                if (name == "Threads") {
-                    // Threads handled in Search::start
-                }
+            }
+
+            // Engine options; buttons come without a value
+            if (ClercX::Options.count(name)) {
+                try {
+                    ClercX::Options[name] = value;
+                } catch (...) {}
             }
         } else if (token == "isready") {
-            std::cout << "readyok" << std::endl;
+            Misc::out("readyok");
         } else if (token == "ucinewgame") {
-            TT.clear();
+            Search::clear();
             game_history.clear();
         } else if (token == "position") {
             std::string sub;
@@ -88,43 +135,10 @@ void loop() {
             if (sub == "moves") {
                 std::string move_str;
                 while (ss >> move_str) {
-                    Move move = Move::none();
-                    // We must generate moves to map string to Move object (with correct type)
-                    std::vector<Move> legal_moves;
-                    MoveGen::generate<MoveGen::ALL>(pos, legal_moves);
-                    
-                    for (Move m : legal_moves) {
-                        std::string m_str = "";
-                        m_str += static_cast<char>('a' + (m.from() % 8));
-                        m_str += std::to_string(m.from() / 8 + 1);
-                        m_str += static_cast<char>('a' + (m.to() % 8));
-                        m_str += std::to_string(m.to() / 8 + 1);
-                        if (m.type() == PROMOTION) {
-                            switch (m.promotion_piece()) {
-                                case QUEEN: m_str += 'q'; break;
-                                case ROOK: m_str += 'r'; break;
-                                case BISHOP: m_str += 'b'; break;
-                                case KNIGHT: m_str += 'n'; break;
-                                default: break;
-                            }
-                        }
-                        if (m_str == move_str) {
-                            move = m;
-                            break;
-                        }
-                    }
-                    
+                    Move move = to_move(pos, move_str);
                     if (move != Move::none()) {
-                        // Validate legality strictly
                          game_history.emplace_back();
                          pos.make_move(move, game_history.back());
-                         
-                         Square k = Bitboards::lsb(pos.pieces(static_cast<Color>(pos.side_to_move() ^ 1), KING));
-                         if (k != SQ_NONE && pos.is_attacked(k, pos.side_to_move())) {
-                             // Illegal move in input! Revert.
-                             pos.unmake_move(move);
-                             game_history.pop_back();
-                         }
                     }
                 }
             }
@@ -139,22 +153,68 @@ void loop() {
 
             std::string sub;
             while (ss >> sub) {
-                if (sub == "depth") ss >> limits.depth;
+                if (sub == "perft") {
+                    // go perft <depth> [hash]
+                    int depth = 1;
+                    ss >> depth >> sub;
+                    Perft::go(pos, depth, sub == "hash");
+                    limits.depth = -1;
+                    break;
+                }
+                else if (sub == "depth") ss >> limits.depth;
+                else if (sub == "nodes") ss >> limits.nodes;
                 else if (sub == "wtime" && pos.side_to_move() == WHITE) { ss >> limits.time; limits.use_time = true; }
                 else if (sub == "btime" && pos.side_to_move() == BLACK) { ss >> limits.time; limits.use_time = true; }
                 else if (sub == "winc" && pos.side_to_move() == WHITE) ss >> limits.inc;
                 else if (sub == "binc" && pos.side_to_move() == BLACK) ss >> limits.inc;
                 else if (sub == "movestogo") ss >> limits.movestogo;
                 else if (sub == "movetime") { ss >> limits.time; limits.use_time = true; limits.is_movetime = true; }
-                else if (sub == "infinite") { limits.depth = 100; limits.use_time = false; }
+                else if (sub == "infinite") { limits.depth = 100; limits.use_time = false; limits.infinite = true; }
+                else if (sub == "ponder") limits.ponder = true;
+                else if (sub == "searchmoves") {
+                    // Moves run to the next token that is not a legal move
+                    std::streampos mark = ss.tellg();
+                    while (ss >> sub) {
+                        Move m = to_move(pos, sub);
+                        if (m == Move::none()) {
+                            ss.clear();
+                            ss.seekg(mark);
+                            break;
+                        }
+                        limits.searchmoves.push_back(m);
+                        mark = ss.tellg();
+                    }
+                }
             }
-            Search::iterate(pos, limits);
+            if (limits.depth >= 0) {
+                Search::start(pos, limits);
+            }
+        } else if (token == "divide") {
+            // divide <depth> [hash]
+            int depth = 1;
+            std::string sub;
+            ss >> depth >> sub;
+            Perft::divide(pos, depth, sub == "hash");
+        } else if (token == "bench") {
+            // bench [hash] [threads] [depth]
+            int hash = 16, threads = 1, depth = 13;
+            ss >> hash >> threads >> depth;
+            Bench::run(hash, threads, depth);
+        } else if (token == "perftsuite") {
+            Perft::suite();
+        } else if (token == "eval") {
+            Misc::out(Eval::trace(pos));
         } else if (token == "stop") {
-            Search::stop_search = true;
+            Search::stop();
+        } else if (token == "ponderhit") {
+            Search::ponderhit();
         } else if (token == "quit") {
             break;
         }
     }
+
+    Search::stop();
+    wait_for_search();
 }
 
 } // namespace UCI
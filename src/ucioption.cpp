@@ -1,4 +1,5 @@
 #include "../include/ucioption.h"
+#include "../include/tt.h"
 #include <algorithm>
 #include <sstream>
 
@@ -75,8 +76,7 @@ OptionsMap::OptionsMap() {}
 void OptionsMap::init() {
     // Hash (1-65536 MB)
     options["Hash"] = Option(16, 1, 65536, [](const Option& o) {
-        std::cout << "info string Hash set to " << int(o) << " MB" << std::endl;
-        // Logic to resize TT would go here: TT.resize(int(o));
+        TT.resize(int(o));
     });
 
     // Threads (1-128)
@@ -87,8 +87,7 @@ void OptionsMap::init() {
 
     // Clear Hash (button)
     options["Clear Hash"] = Option(Option::OnChange([](const Option&) {
-        std::cout << "info string Hash cleared" << std::endl;
-        // Logic to clear TT: TT.clear();
+        TT.clear();
     }));
 
     // Contempt (-100 to 100)
@@ -97,6 +96,9 @@ void OptionsMap::init() {
     // Move Overhead (0-5000ms)
     options["Move Overhead"] = Option(10, 0, 5000);
 
+    // nodestime: nodes per millisecond the clock is converted at (0 = off)
+    options["nodestime"] = Option(0, 0, 100000);
+
     // MultiPV (1-500)
     options["MultiPV"] = Option(1, 1, 500);
 
@@ -7,6 +7,7 @@ uint64_t piece_keys[PIECE_NB][SQ_NB];
 uint64_t side_key;
 uint64_t castle_keys[16];
 uint64_t en_passant_keys[SQ_NB];
+uint64_t material_keys[PIECE_NB][16];
 
 void init() {
     std::mt19937_64 rng(1070372); // Deterministic seed
@@ -22,6 +23,10 @@ void init() {
         
     for (int i = 0; i < SQ_NB; ++i)
         en_passant_keys[i] = rng();
+
+    for (int p = 0; p < PIECE_NB; ++p)
+        for (int n = 0; n < 16; ++n)
+            material_keys[p][n] = rng();
 }
 
 } // namespace Zobrist